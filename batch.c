@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "playlist.h"
+
+// Batch mode: runs playlist commands from a file (or stdin), one per line.
+//
+//   add|title|artist|genre|year
+//   delete|title
+//   find|title
+//   artist|name
+//   genre|name
+//   year|year
+//   shuffle
+//   artist-stats
+//   genre-stats
+//   print
+//
+// Blank lines and lines starting with '#' are ignored.
+
+#define MAX_FIELDS 5
+
+void printSong(const SongInfo *song, void *context) {
+    (void)context;
+    printf("%s by %s (%s, %d)\n", song->title, song->artist, song->genre, song->year);
+}
+
+int splitFields(char *line, char *fields[], int maxFields) {
+    int count = 0;
+    char *start = line;
+
+    while (count < maxFields) {
+        char *sep = strchr(start, '|');
+        fields[count++] = start;
+        if (sep == NULL) {
+            break;
+        }
+        *sep = '\0';
+        start = sep + 1;
+    }
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    Playlist *playlist;
+    char line[1024];
+    char *fields[MAX_FIELDS] = { NULL };
+    int lineNumber = 0;
+    FILE *in = stdin;
+
+    if (argc > 1) {
+        in = fopen(argv[1], "r");
+        if (in == NULL) {
+            fprintf(stderr, "Cannot open '%s'\n", argv[1]);
+            return 1;
+        }
+    }
+
+    playlist = playlistCreate();
+    if (playlist == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    unsigned int seed = (unsigned int)time(NULL);
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        PlaylistStatus status = PLAYLIST_OK;
+
+        lineNumber++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        int n = splitFields(line, fields, MAX_FIELDS);
+        const char *cmd = fields[0];
+
+        if (strcmp(cmd, "add") == 0 && n == 5) {
+            status = playlistAdd(playlist, fields[1], fields[2], fields[3], atoi(fields[4]));
+        } else if (strcmp(cmd, "delete") == 0 && n == 2) {
+            status = playlistDelete(playlist, fields[1]);
+        } else if (strcmp(cmd, "find") == 0 && n == 2) {
+            SongInfo song;
+            status = playlistFind(playlist, fields[1], &song);
+            if (status == PLAYLIST_OK) {
+                printSong(&song, NULL);
+            }
+        } else if (strcmp(cmd, "artist") == 0 && n == 2) {
+            playlistFilterByArtist(playlist, fields[1], printSong, NULL);
+        } else if (strcmp(cmd, "genre") == 0 && n == 2) {
+            playlistFilterByGenre(playlist, fields[1], printSong, NULL);
+        } else if (strcmp(cmd, "year") == 0 && n == 2) {
+            playlistFilterByYear(playlist, atoi(fields[1]), printSong, NULL);
+        } else if (strcmp(cmd, "shuffle") == 0 && n == 1) {
+            status = playlistShuffle(playlist, &seed, printSong, NULL);
+        } else if (strcmp(cmd, "artist-stats") == 0 && n == 1) {
+            char mostCommonArtist[PLAYLIST_ARTIST_MAX];
+            int maxCount = 0;
+            status = playlistMostCommonArtist(playlist, mostCommonArtist, &maxCount);
+            if (status == PLAYLIST_OK) {
+                printf("Most common artist: %s (%d songs)\n", mostCommonArtist, maxCount);
+            }
+        } else if (strcmp(cmd, "genre-stats") == 0 && n == 1) {
+            char mostCommonGenre[PLAYLIST_GENRE_MAX];
+            int maxCount = 0;
+            status = playlistMostCommonGenre(playlist, mostCommonGenre, &maxCount);
+            if (status == PLAYLIST_OK) {
+                printf("Most common genre: %s (%d songs)\n", mostCommonGenre, maxCount);
+            }
+        } else if (strcmp(cmd, "print") == 0 && n == 1) {
+            playlistForEach(playlist, printSong, NULL);
+        } else {
+            fprintf(stderr, "line %d: unknown command '%s'\n", lineNumber, cmd);
+            continue;
+        }
+
+        if (status != PLAYLIST_OK) {
+            fprintf(stderr, "line %d: %s: %s\n", lineNumber, cmd, playlistStatusString(status));
+        }
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    playlistDestroy(playlist);
+    return 0;
+}
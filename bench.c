@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "playlist.h"
+#include "catalog.h"
+#include "changefeed.h"
+
+// Benchmark workload. Also used as the training run for PGO builds.
+//
+//   playlist_bench [songs] [seed]
+
+static const char *artists[] = {
+    "queen", "abba", "the beatles", "nirvana", "radiohead", "madonna",
+    "prince", "daft punk", "metallica", "adele", "coldplay", "u2"
+};
+static const char *genres[] = {
+    "rock", "pop", "jazz", "metal", "electronic", "hip hop", "classical", "folk"
+};
+
+#define ARTIST_COUNT (int)(sizeof(artists) / sizeof(artists[0]))
+#define GENRE_COUNT (int)(sizeof(genres) / sizeof(genres[0]))
+#define FIRST_YEAR 1960
+#define YEAR_COUNT 64
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void report(const char *phase, int ops, double seconds) {
+    printf("%-14s %9d ops %10.3f ms %12.0f ops/s\n", phase, ops, seconds * 1e3, ops / seconds);
+}
+
+// Row-at-a-time baseline for the catalog kernels: songs from the 80s and
+// songs per genre per year
+typedef struct rowScan {
+    int eighties;
+    int genreByYear[GENRE_COUNT * YEAR_COUNT];
+} RowScan;
+
+void scanRow(const SongInfo *song, void *context) {
+    RowScan *scan = (RowScan *)context;
+    int genre = 0;
+
+    scan->eighties += song->year >= 1980 && song->year <= 1989;
+    while (genre < GENRE_COUNT - 1 && strcmp(song->genre, genres[genre]) != 0) {
+        genre++;
+    }
+    scan->genreByYear[genre * YEAR_COUNT + song->year - FIRST_YEAR]++;
+}
+
+// Compare the catalog kernels' results against the row scan. Catalog genre
+// IDs follow first appearance in title order, so map them back by name.
+int checkCatalog(const Catalog *catalog, const RowScan *scan, int eighties, const int *genreByYear) {
+    int years = catalogMaxYear(catalog) - catalogMinYear(catalog) + 1;
+    int genre, year;
+
+    if (eighties != scan->eighties) {
+        fprintf(stderr, "catalog mismatch: %d songs from the 80s, expected %d\n", eighties, scan->eighties);
+        return -1;
+    }
+    for (genre = 0; genre < catalogGenreCount(catalog); genre++) {
+        const char *name = catalogGenreName(catalog, genre);
+        int row = 0;
+        while (row < GENRE_COUNT && strcmp(name, genres[row]) != 0) {
+            row++;
+        }
+        if (row == GENRE_COUNT) {
+            fprintf(stderr, "catalog mismatch: unknown genre %s\n", name);
+            return -1;
+        }
+        for (year = 0; year < years; year++) {
+            int expected = scan->genreByYear[row * YEAR_COUNT + catalogMinYear(catalog) + year - FIRST_YEAR];
+            if (genreByYear[genre * years + year] != expected) {
+                fprintf(stderr, "catalog mismatch: %d %s songs from %d, expected %d\n",
+                        genreByYear[genre * years + year], name, catalogMinYear(catalog) + year, expected);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 200000;
+    unsigned int seed = argc > 2 ? (unsigned int)atoi(argv[2]) : 42;
+    Playlist *playlist;
+    char (*titles)[PLAYLIST_TITLE_MAX];
+    int i;
+
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [songs] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    titles = malloc((size_t)count * sizeof(*titles));
+    playlist = playlistCreate();
+    if (titles == NULL || playlist == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    srand(seed);
+    for (i = 0; i < count; i++) {
+        snprintf(titles[i], sizeof(titles[i]), "song %08x %d", (unsigned int)rand(), i);
+    }
+
+    double start = now();
+    for (i = 0; i < count; i++) {
+        playlistAdd(playlist, titles[i], artists[i % ARTIST_COUNT], genres[(i / 3) % GENRE_COUNT], FIRST_YEAR + i % YEAR_COUNT);
+    }
+    report("insert", count, now() - start);
+
+    int found = 0;
+    start = now();
+    for (i = 0; i < count; i++) {
+        found += playlistFind(playlist, titles[(long long)i * 7919 % count], NULL) == PLAYLIST_OK;
+    }
+    report("lookup", count, now() - start);
+
+    int matched = 0;
+    start = now();
+    for (i = 0; i < GENRE_COUNT; i++) {
+        matched += playlistFilterByGenre(playlist, genres[i], NULL, NULL);
+    }
+    report("filter", GENRE_COUNT, now() - start);
+
+    char mostCommon[PLAYLIST_ARTIST_MAX];
+    int maxCount = 0;
+    start = now();
+    playlistMostCommonArtist(playlist, mostCommon, &maxCount);
+    playlistMostCommonGenre(playlist, mostCommon, &maxCount);
+    report("stats", 2, now() - start);
+
+    RowScan *scan = calloc(1, sizeof(RowScan));
+    if (scan == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    start = now();
+    playlistForEach(playlist, scanRow, scan);
+    report("row scan", playlistSize(playlist), now() - start);
+
+    start = now();
+    Catalog *catalog = catalogBuild(playlist);
+    report("catalog build", playlistSize(playlist), now() - start);
+    if (catalog == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    int *genreByYear = malloc((size_t)catalogGenreCount(catalog) *
+                              (size_t)(catalogMaxYear(catalog) - catalogMinYear(catalog) + 1) * sizeof(int));
+    if (genreByYear == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    start = now();
+    int eighties = catalogCountYears(catalog, 1980, 1989);
+    catalogCountGenreByYear(catalog, genreByYear);
+    report("column scan", catalogSize(catalog), now() - start);
+    if (checkCatalog(catalog, scan, eighties, genreByYear) != 0) {
+        return 1;
+    }
+    free(genreByYear);
+    free(scan);
+    catalogDestroy(catalog);
+
+    start = now();
+    playlistShuffle(playlist, &seed, NULL, NULL);
+    report("shuffle", playlistSize(playlist), now() - start);
+
+    // Deletes publish to a change feed, which is then drained by a consumer
+    ChangeFeed *feed = changeFeedCreate(count);
+    if (feed == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    playlistAttachChangeFeed(playlist, feed);
+    start = now();
+    for (i = 0; i < count; i += 2) {
+        playlistDelete(playlist, titles[i]);
+    }
+    report("delete", (count + 1) / 2, now() - start);
+
+    ChangeRecord records[256];
+    uint64_t cursor = 1;
+    int changes = 0;
+    int read;
+    start = now();
+    while (changeFeedRead(feed, &cursor, records, 256, &read) == PLAYLIST_OK && read > 0) {
+        changes += read;
+    }
+    report("change feed", changes, now() - start);
+    playlistAttachChangeFeed(playlist, NULL);
+    changeFeedDestroy(feed);
+
+    printf("found %d/%d, filtered %d, remaining %d\n", found, count, matched, playlistSize(playlist));
+    playlistDestroy(playlist);
+    free(titles);
+    return 0;
+}
@@ -0,0 +1,465 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+#include "catalog.h"
+
+#define MAX_GENRES 65535   // genre IDs are stored in 16 bits
+
+// Interned strings with a case-insensitive open-addressing index
+typedef struct dictionary {
+    char **names;
+    int count;
+    int capacity;
+    int *slots;        // index into names, -1 when free
+    int slotCount;     // power of two
+} Dictionary;
+
+struct catalog {
+    int size;
+    Dictionary artists;
+    Dictionary genres;
+    uint32_t *artistColumn;
+    uint16_t *genreColumn;
+    int minYear;
+    int maxYear;
+    int yearWidth;     // bytes per entry in the year column
+    union {
+        uint8_t *narrow;
+        uint16_t *medium;
+        uint32_t *wide;
+        void *data;
+    } yearColumn;      // year - minYear
+    char *titles;             // NUL-terminated titles back to back
+    uint32_t *titleOffsets;   // size + 1 entries
+};
+
+static uint32_t hashName(const char *name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint32_t)tolower((unsigned char)*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int sameName(const char *a, const char *b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        ++a;
+        ++b;
+    }
+    return tolower((unsigned char)*a) == tolower((unsigned char)*b);
+}
+
+static int *findSlot(const Dictionary *dictionary, const char *name) {
+    uint32_t mask = (uint32_t)dictionary->slotCount - 1;
+    uint32_t i = hashName(name) & mask;
+
+    while (dictionary->slots[i] >= 0 && !sameName(dictionary->names[dictionary->slots[i]], name)) {
+        i = (i + 1) & mask;
+    }
+    return &dictionary->slots[i];
+}
+
+static int dictionaryInit(Dictionary *dictionary, int expected) {
+    int i;
+
+    dictionary->count = 0;
+    dictionary->capacity = 16;
+    dictionary->slotCount = 32;
+    while (dictionary->slotCount < expected * 2) {
+        dictionary->slotCount *= 2;
+    }
+    dictionary->names = (char **)malloc((size_t)dictionary->capacity * sizeof(char *));
+    dictionary->slots = (int *)malloc((size_t)dictionary->slotCount * sizeof(int));
+    if (dictionary->names == NULL || dictionary->slots == NULL) {
+        return -1;
+    }
+    for (i = 0; i < dictionary->slotCount; i++) {
+        dictionary->slots[i] = -1;
+    }
+    return 0;
+}
+
+static void dictionaryFree(Dictionary *dictionary) {
+    int i;
+    for (i = 0; i < dictionary->count; i++) {
+        free(dictionary->names[i]);
+    }
+    free(dictionary->names);
+    free(dictionary->slots);
+}
+
+static int dictionaryGrow(Dictionary *dictionary) {
+    int *slots = (int *)malloc((size_t)dictionary->slotCount * 2 * sizeof(int));
+    int i;
+
+    if (slots == NULL) {
+        return -1;
+    }
+    free(dictionary->slots);
+    dictionary->slots = slots;
+    dictionary->slotCount *= 2;
+    for (i = 0; i < dictionary->slotCount; i++) {
+        slots[i] = -1;
+    }
+    for (i = 0; i < dictionary->count; i++) {
+        *findSlot(dictionary, dictionary->names[i]) = i;
+    }
+    return 0;
+}
+
+// Returns the ID for name, adding it if needed; -1 if out of memory
+static int dictionaryIntern(Dictionary *dictionary, const char *name) {
+    int *slot = findSlot(dictionary, name);
+    if (*slot >= 0) {
+        return *slot;
+    }
+
+    if (dictionary->count == dictionary->capacity) {
+        char **names = (char **)realloc(dictionary->names, (size_t)dictionary->capacity * 2 * sizeof(char *));
+        if (names == NULL) {
+            return -1;
+        }
+        dictionary->names = names;
+        dictionary->capacity *= 2;
+    }
+
+    char *copy = (char *)malloc(strlen(name) + 1);
+    if (copy == NULL) {
+        return -1;
+    }
+    strcpy(copy, name);
+    dictionary->names[dictionary->count] = copy;
+    *slot = dictionary->count++;
+
+    // Keep the index at most half full
+    if (dictionary->count * 2 > dictionary->slotCount && dictionaryGrow(dictionary) != 0) {
+        return -1;
+    }
+    return dictionary->count - 1;
+}
+
+static int dictionaryFind(const Dictionary *dictionary, const char *name) {
+    return *findSlot(dictionary, name);
+}
+
+// Row-at-a-time state while walking the playlist
+typedef struct builder {
+    Catalog *catalog;
+    int *years;
+    size_t titleBytes;
+    size_t titleCapacity;
+    int failed;
+} Builder;
+
+static void addRow(const SongInfo *song, void *context) {
+    Builder *builder = (Builder *)context;
+    Catalog *catalog = builder->catalog;
+    int row = catalog->size;
+    size_t length = strlen(song->title) + 1;
+
+    if (builder->failed) {
+        return;
+    }
+
+    int artist = dictionaryIntern(&catalog->artists, song->artist);
+    int genre = dictionaryIntern(&catalog->genres, song->genre);
+    if (artist < 0 || genre < 0 || genre >= MAX_GENRES) {
+        builder->failed = 1;
+        return;
+    }
+
+    if (builder->titleBytes + length > builder->titleCapacity) {
+        size_t capacity = builder->titleCapacity * 2 + length;
+        char *titles = (char *)realloc(catalog->titles, capacity);
+        if (titles == NULL) {
+            builder->failed = 1;
+            return;
+        }
+        catalog->titles = titles;
+        builder->titleCapacity = capacity;
+    }
+    memcpy(catalog->titles + builder->titleBytes, song->title, length);
+    builder->titleBytes += length;
+
+    catalog->artistColumn[row] = (uint32_t)artist;
+    catalog->genreColumn[row] = (uint16_t)genre;
+    catalog->titleOffsets[row + 1] = (uint32_t)builder->titleBytes;
+    builder->years[row] = song->year;
+    catalog->size++;
+}
+
+// Frame-of-reference encode the years into the narrowest column that fits
+static int packYears(Catalog *catalog, const int *years) {
+    int i;
+
+    catalog->minYear = catalog->maxYear = catalog->size > 0 ? years[0] : 0;
+    for (i = 1; i < catalog->size; i++) {
+        if (years[i] < catalog->minYear) {
+            catalog->minYear = years[i];
+        }
+        if (years[i] > catalog->maxYear) {
+            catalog->maxYear = years[i];
+        }
+    }
+
+    unsigned int span = (unsigned int)(catalog->maxYear - catalog->minYear);
+    catalog->yearWidth = span <= UINT8_MAX ? 1 : span <= UINT16_MAX ? 2 : 4;
+    catalog->yearColumn.data = malloc((size_t)(catalog->size ? catalog->size : 1) * (size_t)catalog->yearWidth);
+    if (catalog->yearColumn.data == NULL) {
+        return -1;
+    }
+
+    for (i = 0; i < catalog->size; i++) {
+        unsigned int delta = (unsigned int)(years[i] - catalog->minYear);
+        switch (catalog->yearWidth) {
+            case 1:
+                catalog->yearColumn.narrow[i] = (uint8_t)delta;
+                break;
+            case 2:
+                catalog->yearColumn.medium[i] = (uint16_t)delta;
+                break;
+            default:
+                catalog->yearColumn.wide[i] = delta;
+        }
+    }
+    return 0;
+}
+
+Catalog *catalogBuild(const Playlist *playlist) {
+    int size = playlistSize(playlist);
+    size_t rows = (size_t)(size ? size : 1);
+    Catalog *catalog = (Catalog *)calloc(1, sizeof(Catalog));
+    Builder builder;
+
+    if (catalog == NULL) {
+        return NULL;
+    }
+
+    memset(&builder, 0, sizeof(builder));
+    builder.catalog = catalog;
+    builder.titleCapacity = rows * 16;
+    builder.years = (int *)malloc(rows * sizeof(int));
+    catalog->artistColumn = (uint32_t *)malloc(rows * sizeof(uint32_t));
+    catalog->genreColumn = (uint16_t *)malloc(rows * sizeof(uint16_t));
+    catalog->titleOffsets = (uint32_t *)malloc((rows + 1) * sizeof(uint32_t));
+    catalog->titles = (char *)malloc(builder.titleCapacity);
+    if (builder.years == NULL || catalog->artistColumn == NULL || catalog->genreColumn == NULL ||
+        catalog->titleOffsets == NULL || catalog->titles == NULL ||
+        dictionaryInit(&catalog->artists, 64) != 0 || dictionaryInit(&catalog->genres, 16) != 0) {
+        free(builder.years);
+        catalogDestroy(catalog);
+        return NULL;
+    }
+
+    catalog->titleOffsets[0] = 0;
+    playlistForEach(playlist, addRow, &builder);
+    if (builder.failed || packYears(catalog, builder.years) != 0) {
+        free(builder.years);
+        catalogDestroy(catalog);
+        return NULL;
+    }
+
+    free(builder.years);
+    return catalog;
+}
+
+void catalogDestroy(Catalog *catalog) {
+    if (catalog == NULL) {
+        return;
+    }
+    dictionaryFree(&catalog->artists);
+    dictionaryFree(&catalog->genres);
+    free(catalog->artistColumn);
+    free(catalog->genreColumn);
+    free(catalog->yearColumn.data);
+    free(catalog->titles);
+    free(catalog->titleOffsets);
+    free(catalog);
+}
+
+int catalogSize(const Catalog *catalog) {
+    return catalog->size;
+}
+
+int catalogArtistCount(const Catalog *catalog) {
+    return catalog->artists.count;
+}
+
+int catalogGenreCount(const Catalog *catalog) {
+    return catalog->genres.count;
+}
+
+const char *catalogArtistName(const Catalog *catalog, int artist) {
+    return artist >= 0 && artist < catalog->artists.count ? catalog->artists.names[artist] : NULL;
+}
+
+const char *catalogGenreName(const Catalog *catalog, int genre) {
+    return genre >= 0 && genre < catalog->genres.count ? catalog->genres.names[genre] : NULL;
+}
+
+int catalogFindArtist(const Catalog *catalog, const char *name) {
+    return dictionaryFind(&catalog->artists, name);
+}
+
+int catalogFindGenre(const Catalog *catalog, const char *name) {
+    return dictionaryFind(&catalog->genres, name);
+}
+
+const char *catalogTitle(const Catalog *catalog, int row) {
+    return catalog->titles + catalog->titleOffsets[row];
+}
+
+int catalogArtist(const Catalog *catalog, int row) {
+    return (int)catalog->artistColumn[row];
+}
+
+int catalogGenre(const Catalog *catalog, int row) {
+    return (int)catalog->genreColumn[row];
+}
+
+int catalogYear(const Catalog *catalog, int row) {
+    switch (catalog->yearWidth) {
+        case 1:
+            return catalog->minYear + catalog->yearColumn.narrow[row];
+        case 2:
+            return catalog->minYear + catalog->yearColumn.medium[row];
+        default:
+            return catalog->minYear + (int)catalog->yearColumn.wide[row];
+    }
+}
+
+int catalogMinYear(const Catalog *catalog) {
+    return catalog->minYear;
+}
+
+int catalogMaxYear(const Catalog *catalog) {
+    return catalog->maxYear;
+}
+
+// Clamp [from, to] to the catalog and turn it into year-column deltas.
+// Returns 0 when no row can match.
+static int yearRange(const Catalog *catalog, int from, int to, uint32_t *low, uint32_t *span) {
+    if (catalog->size == 0 || from > to || to < catalog->minYear || from > catalog->maxYear) {
+        return 0;
+    }
+    if (from < catalog->minYear) {
+        from = catalog->minYear;
+    }
+    if (to > catalog->maxYear) {
+        to = catalog->maxYear;
+    }
+    *low = (uint32_t)(from - catalog->minYear);
+    *span = (uint32_t)(to - from);
+    return 1;
+}
+
+// The kernels below are written once per year-column width. Unsigned
+// wrap-around folds the two range comparisons into one, so the year loops
+// have no branches. Only COUNT_YEARS vectorizes at -O3 (check with
+// -fopt-info-vec). SELECT_YEARS carries a dependency through count, which
+// picks the output slot, and the histograms scatter increments that may
+// collide. Those loops run scalar.
+
+#define COUNT_YEARS(column)                                  \
+    for (i = 0; i < n; i++) {                                \
+        count += (uint32_t)(column[i] - low) <= span;        \
+    }
+
+#define SELECT_YEARS(column)                                 \
+    for (i = 0; i < n; i++) {                                \
+        rows[count] = i;                                     \
+        count += (uint32_t)(column[i] - low) <= span;        \
+    }
+
+#define COUNT_GENRE_BY_YEAR(column)                          \
+    for (i = 0; i < n; i++) {                                \
+        counts[genres[i] * years + column[i]]++;             \
+    }
+
+int catalogCountYears(const Catalog *catalog, int from, int to) {
+    uint32_t low, span;
+    int count = 0;
+    int n = catalog->size;
+    int i;
+
+    if (!yearRange(catalog, from, to, &low, &span)) {
+        return 0;
+    }
+    switch (catalog->yearWidth) {
+        case 1:
+            COUNT_YEARS(catalog->yearColumn.narrow);
+            break;
+        case 2:
+            COUNT_YEARS(catalog->yearColumn.medium);
+            break;
+        default:
+            COUNT_YEARS(catalog->yearColumn.wide);
+    }
+    return count;
+}
+
+int catalogSelectYears(const Catalog *catalog, int from, int to, int *rows) {
+    uint32_t low, span;
+    int count = 0;
+    int n = catalog->size;
+    int i;
+
+    if (!yearRange(catalog, from, to, &low, &span)) {
+        return 0;
+    }
+    switch (catalog->yearWidth) {
+        case 1:
+            SELECT_YEARS(catalog->yearColumn.narrow);
+            break;
+        case 2:
+            SELECT_YEARS(catalog->yearColumn.medium);
+            break;
+        default:
+            SELECT_YEARS(catalog->yearColumn.wide);
+    }
+    return count;
+}
+
+void catalogCountArtists(const Catalog *catalog, int *counts) {
+    const uint32_t *artists = catalog->artistColumn;
+    int n = catalog->size;   // counts may alias catalog, so keep the bound in a local
+    int i;
+
+    memset(counts, 0, (size_t)catalog->artists.count * sizeof(int));
+    for (i = 0; i < n; i++) {
+        counts[artists[i]]++;
+    }
+}
+
+void catalogCountGenres(const Catalog *catalog, int *counts) {
+    const uint16_t *genres = catalog->genreColumn;
+    int n = catalog->size;
+    int i;
+
+    memset(counts, 0, (size_t)catalog->genres.count * sizeof(int));
+    for (i = 0; i < n; i++) {
+        counts[genres[i]]++;
+    }
+}
+
+void catalogCountGenreByYear(const Catalog *catalog, int *counts) {
+    const uint16_t *genres = catalog->genreColumn;
+    size_t years = (size_t)(catalog->maxYear - catalog->minYear) + 1;
+    int n = catalog->size;
+    int i;
+
+    memset(counts, 0, (size_t)catalog->genres.count * years * sizeof(int));
+    switch (catalog->yearWidth) {
+        case 1:
+            COUNT_GENRE_BY_YEAR(catalog->yearColumn.narrow);
+            break;
+        case 2:
+            COUNT_GENRE_BY_YEAR(catalog->yearColumn.medium);
+            break;
+        default:
+            COUNT_GENRE_BY_YEAR(catalog->yearColumn.wide);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "playlist.h"
+
+// Columnar snapshot of a playlist for analytics.
+//
+// Each song is a row, in title order. Artist and genre are stored as
+// dictionary IDs (case-insensitive, first spelling wins). Year is stored as
+// an offset from the smallest year, in the narrowest integer that fits.
+// Titles live in one contiguous arena. The whole-catalog kernels below only
+// touch the columns they need. Counting a year range is a branch-free loop
+// that GCC and Clang vectorize at -O3. Selection and the histograms stay
+// scalar but still stream a single narrow column.
+//
+// A catalog does not follow later changes to its playlist; build a new one
+// to pick them up.
+
+typedef struct catalog Catalog;
+
+// Returns NULL if out of memory or the playlist has more than 65535 genres
+Catalog *catalogBuild(const Playlist *playlist);
+void catalogDestroy(Catalog *catalog);
+
+int catalogSize(const Catalog *catalog);
+int catalogArtistCount(const Catalog *catalog);
+int catalogGenreCount(const Catalog *catalog);
+const char *catalogArtistName(const Catalog *catalog, int artist);
+const char *catalogGenreName(const Catalog *catalog, int genre);
+int catalogFindArtist(const Catalog *catalog, const char *name);   // -1 if unknown
+int catalogFindGenre(const Catalog *catalog, const char *name);
+
+// Row accessors
+const char *catalogTitle(const Catalog *catalog, int row);
+int catalogArtist(const Catalog *catalog, int row);
+int catalogGenre(const Catalog *catalog, int row);
+int catalogYear(const Catalog *catalog, int row);
+
+// Year range covered by the catalog (both 0 when it is empty)
+int catalogMinYear(const Catalog *catalog);
+int catalogMaxYear(const Catalog *catalog);
+
+// Songs with from <= year <= to. catalogSelectYears also writes their row
+// numbers to rows, which must hold catalogSize() entries.
+int catalogCountYears(const Catalog *catalog, int from, int to);
+int catalogSelectYears(const Catalog *catalog, int from, int to, int *rows);
+
+// Histograms. counts must hold catalogArtistCount() or catalogGenreCount()
+// entries; catalogCountGenreByYear fills a genre-major table of
+// catalogGenreCount() * (catalogMaxYear() - catalogMinYear() + 1) entries.
+void catalogCountArtists(const Catalog *catalog, int *counts);
+void catalogCountGenres(const Catalog *catalog, int *counts);
+void catalogCountGenreByYear(const Catalog *catalog, int *counts);
+
+#endif
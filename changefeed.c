@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "changefeed.h"
+
+// Each slot is a small seqlock. The writer zeroes the slot's sequence,
+// fills in the slot, then stores the record's sequence. A reader copies
+// the slot and checks that the sequence was the one it wanted both before
+// and after the copy. If it changed, the writer lapped the reader.
+//
+// Slots hold only fixed-size fields. The title, artist and genre are packed
+// back to back into a byte ring (the arena), so a record costs its actual
+// text length rather than three maximum-size arrays. arenaHead counts every
+// byte ever written. The writer advances it before overwriting old bytes,
+// so a reader that finds arenaHead - offset > arena size after copying
+// knows its bytes were overwritten. The writer also keeps oldest, the first
+// record whose slot and bytes are both still intact.
+
+#define ARENA_BYTES_PER_RECORD 64
+#define MIN_ARENA_SIZE 1024
+
+typedef struct slot {
+    _Atomic uint64_t sequence;
+    uint64_t offset;             // arena position of the record's text
+    int32_t year;
+    uint8_t type;
+    uint8_t titleLength;
+    uint8_t artistLength;
+    uint8_t genreLength;
+} Slot;
+
+struct changeFeed {
+    _Atomic uint64_t next;       // sequence of the next record to publish
+    _Atomic uint64_t oldest;     // oldest record still readable
+    _Atomic uint64_t arenaHead;  // arena bytes written so far
+    uint64_t mask;
+    uint64_t arenaMask;
+    Slot *slots;
+    char *arena;
+};
+
+ChangeFeed *changeFeedCreate(int capacity) {
+    ChangeFeed *feed = (ChangeFeed *)malloc(sizeof(ChangeFeed));
+    uint64_t size = 1;
+    uint64_t arenaSize = MIN_ARENA_SIZE;
+    uint64_t i;
+
+    if (feed == NULL) {
+        return NULL;
+    }
+    while (size < (uint64_t)(capacity > 0 ? capacity : 1)) {
+        size *= 2;
+    }
+    while (arenaSize < size * ARENA_BYTES_PER_RECORD) {
+        arenaSize *= 2;
+    }
+
+    feed->slots = (Slot *)malloc(size * sizeof(Slot));
+    feed->arena = (char *)malloc(arenaSize);
+    if (feed->slots == NULL || feed->arena == NULL) {
+        free(feed->slots);
+        free(feed->arena);
+        free(feed);
+        return NULL;
+    }
+    for (i = 0; i < size; i++) {
+        atomic_init(&feed->slots[i].sequence, 0);
+    }
+    feed->mask = size - 1;
+    feed->arenaMask = arenaSize - 1;
+    atomic_init(&feed->next, 1);
+    atomic_init(&feed->oldest, 1);
+    atomic_init(&feed->arenaHead, 0);
+    return feed;
+}
+
+void changeFeedDestroy(ChangeFeed *feed) {
+    if (feed == NULL) {
+        return;
+    }
+    free(feed->slots);
+    free(feed->arena);
+    free(feed);
+}
+
+static uint8_t fieldLength(const char *field, size_t size) {
+    size_t length = 0;
+    while (length < size - 1 && field[length] != '\0') {
+        length++;
+    }
+    return (uint8_t)length;
+}
+
+// Copy between the arena and a flat buffer, wrapping at the end of the ring
+static void arenaWrite(ChangeFeed *feed, uint64_t position, const char *data, size_t length) {
+    size_t start = (size_t)(position & feed->arenaMask);
+    size_t first = (size_t)feed->arenaMask + 1 - start;
+
+    if (first > length) {
+        first = length;
+    }
+    memcpy(feed->arena + start, data, first);
+    memcpy(feed->arena, data + first, length - first);
+}
+
+static void arenaRead(const ChangeFeed *feed, uint64_t position, char *data, size_t length) {
+    size_t start = (size_t)(position & feed->arenaMask);
+    size_t first = (size_t)feed->arenaMask + 1 - start;
+
+    if (first > length) {
+        first = length;
+    }
+    memcpy(data, feed->arena + start, first);
+    memcpy(data + first, feed->arena, length - first);
+    data[length] = '\0';
+}
+
+void changeFeedPublish(ChangeFeed *feed, ChangeType type, const SongInfo *song) {
+    uint64_t sequence = atomic_load_explicit(&feed->next, memory_order_relaxed);
+    uint64_t oldest = atomic_load_explicit(&feed->oldest, memory_order_relaxed);
+    uint64_t position = atomic_load_explicit(&feed->arenaHead, memory_order_relaxed);
+    uint64_t arenaSize = feed->arenaMask + 1;
+    Slot *slot = &feed->slots[sequence & feed->mask];
+    uint8_t titleLength = fieldLength(song->title, PLAYLIST_TITLE_MAX);
+    uint8_t artistLength = fieldLength(song->artist, PLAYLIST_ARTIST_MAX);
+    uint8_t genreLength = fieldLength(song->genre, PLAYLIST_GENRE_MAX);
+    uint64_t head = position + titleLength + artistLength + genreLength;
+
+    // Retire records whose slot or text this one is about to overwrite.
+    // Only the writer touches slot contents outside the seqlock.
+    while (oldest < sequence) {
+        const Slot *old = &feed->slots[oldest & feed->mask];
+        if (sequence - oldest < feed->mask + 1 && head - old->offset <= arenaSize) {
+            break;
+        }
+        oldest++;
+    }
+    atomic_store_explicit(&feed->oldest, oldest, memory_order_relaxed);
+    atomic_store_explicit(&feed->arenaHead, head, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->offset = position;
+    slot->year = song->year;
+    slot->type = (uint8_t)type;
+    slot->titleLength = titleLength;
+    slot->artistLength = artistLength;
+    slot->genreLength = genreLength;
+    arenaWrite(feed, position, song->title, titleLength);
+    arenaWrite(feed, position + titleLength, song->artist, artistLength);
+    arenaWrite(feed, position + titleLength + artistLength, song->genre, genreLength);
+
+    atomic_store_explicit(&slot->sequence, sequence, memory_order_release);
+    atomic_store_explicit(&feed->next, sequence + 1, memory_order_release);
+}
+
+uint64_t changeFeedNextSequence(const ChangeFeed *feed) {
+    return atomic_load_explicit(&feed->next, memory_order_acquire);
+}
+
+uint64_t changeFeedOldestSequence(const ChangeFeed *feed) {
+    return atomic_load_explicit(&feed->oldest, memory_order_acquire);
+}
+
+PlaylistStatus changeFeedRead(const ChangeFeed *feed, uint64_t *cursor, ChangeRecord *records, int max, int *count) {
+    uint64_t next = changeFeedNextSequence(feed);
+    uint64_t arenaSize = feed->arenaMask + 1;
+    uint64_t sequence = *cursor;
+    int copied = 0;
+
+    *count = 0;
+    if (sequence < changeFeedOldestSequence(feed)) {
+        return PLAYLIST_ERR_LAPPED;
+    }
+
+    while (copied < max && sequence < next) {
+        Slot *slot = &feed->slots[sequence & feed->mask];
+        ChangeRecord *record = &records[copied];
+
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != sequence) {
+            return PLAYLIST_ERR_LAPPED;
+        }
+        uint64_t offset = slot->offset;
+        uint8_t titleLength = slot->titleLength;
+        uint8_t artistLength = slot->artistLength;
+        uint8_t genreLength = slot->genreLength;
+        record->sequence = sequence;
+        record->type = (ChangeType)slot->type;
+        record->year = slot->year;
+        // A slot read while the writer rewrites it can hold any lengths.
+        // Reject impossible ones before they overrun the record.
+        if (titleLength >= PLAYLIST_TITLE_MAX || artistLength >= PLAYLIST_ARTIST_MAX ||
+            genreLength >= PLAYLIST_GENRE_MAX) {
+            return PLAYLIST_ERR_LAPPED;
+        }
+        arenaRead(feed, offset, record->title, titleLength);
+        arenaRead(feed, offset + titleLength, record->artist, artistLength);
+        arenaRead(feed, offset + titleLength + artistLength, record->genre, genreLength);
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) != sequence ||
+            atomic_load_explicit(&feed->arenaHead, memory_order_relaxed) - offset > arenaSize) {
+            return PLAYLIST_ERR_LAPPED;
+        }
+
+        copied++;
+        sequence++;
+    }
+
+    *cursor = sequence;
+    *count = copied;
+    return PLAYLIST_OK;
+}
@@ -0,0 +1,64 @@
+#ifndef CHANGEFEED_H
+#define CHANGEFEED_H
+
+#include <stdint.h>
+
+#include "playlist.h"
+
+// In-process feed of playlist mutations.
+//
+// Every successful add or delete on a playlist with an attached feed is
+// published as a ChangeRecord. Records carry consecutive sequence numbers
+// starting at 1. The feed is a fixed-size ring: it keeps the most recent
+// capacity records, or fewer if their title, artist and genre average more
+// than 64 bytes together. A consumer keeps its own cursor (the next sequence
+// it wants) and reads forward from it. A consumer whose records have been
+// overwritten gets PLAYLIST_ERR_LAPPED and has to reload the playlist.
+//
+// There is one writer, the playlist the feed is attached to, and any number
+// of readers on any thread. Readers never take a lock and never block the
+// writer.
+//
+// To build a replica, take the cursor from changeFeedNextSequence() while
+// holding whatever lock serializes writes to the playlist. Copy the playlist
+// under that same lock, then apply records from the cursor onwards.
+
+typedef struct changeFeed ChangeFeed;
+
+typedef enum changeType {
+    CHANGE_ADD = 1,
+    CHANGE_DELETE
+} ChangeType;
+
+// A delete record describes the song that was removed
+typedef struct changeRecord {
+    uint64_t sequence;
+    ChangeType type;
+    int year;
+    char title[PLAYLIST_TITLE_MAX];
+    char artist[PLAYLIST_ARTIST_MAX];
+    char genre[PLAYLIST_GENRE_MAX];
+} ChangeRecord;
+
+// capacity is rounded up to a power of two. Returns NULL if out of memory.
+ChangeFeed *changeFeedCreate(int capacity);
+void changeFeedDestroy(ChangeFeed *feed);   // detach it from its playlist first
+
+// Publish one record; only the feed's single writer may call this
+void changeFeedPublish(ChangeFeed *feed, ChangeType type, const SongInfo *song);
+
+// Sequence the next published record will get, and the oldest one still
+// held by the ring
+uint64_t changeFeedNextSequence(const ChangeFeed *feed);
+uint64_t changeFeedOldestSequence(const ChangeFeed *feed);
+
+// Copy up to max records starting at *cursor into records and advance
+// *cursor past them. *count is 0 when the consumer is caught up. Returns
+// PLAYLIST_ERR_LAPPED (with *cursor unchanged) if the records at *cursor
+// have already been overwritten.
+PlaylistStatus changeFeedRead(const ChangeFeed *feed, uint64_t *cursor, ChangeRecord *records, int max, int *count);
+
+// Publish every later add and delete on playlist to feed (NULL detaches)
+void playlistAttachChangeFeed(Playlist *playlist, ChangeFeed *feed);
+
+#endif
@@ -0,0 +1,401 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Load generator for playlist_server.
+//
+//   playlist_loadgen [-p port] [-u socket-path] [-c connections]
+//                    [-n requests-per-connection] [-d pipeline-depth]
+//                    [-w write-percent] [-a scan-percent] [-s preload-songs]
+//
+// Preloads the catalog over one connection, then every connection keeps
+// depth requests in flight and records the latency of each one. Reads are
+// title lookups against the preloaded songs; scans are artist filters that
+// walk the whole catalog and match nothing; writes add and later delete
+// songs owned by the connection. Latency is reported overall and per kind.
+// If a connection closes early, only the requests that got a response are
+// reported and the exit status is 1.
+
+static const char *artists[] = {
+    "queen", "abba", "the beatles", "nirvana", "radiohead", "madonna",
+    "prince", "daft punk", "metallica", "adele", "coldplay", "u2"
+};
+static const char *genres[] = {
+    "rock", "pop", "jazz", "metal", "electronic", "hip hop", "classical", "folk"
+};
+
+#define ARTIST_COUNT (int)(sizeof(artists) / sizeof(artists[0]))
+#define GENRE_COUNT (int)(sizeof(genres) / sizeof(genres[0]))
+
+enum { KIND_FIND, KIND_SCAN, KIND_WRITE, KIND_COUNT };
+static const char *kindNames[KIND_COUNT] = { "find", "scan", "write" };
+
+typedef struct options {
+    int port;
+    const char *unixPath;
+    int connections;
+    int requests;
+    int depth;
+    int writePercent;
+    int scanPercent;
+    int songs;
+} Options;
+
+typedef struct client {
+    const Options *options;
+    int id;
+    int fd;
+    double *latencies;
+    char *kinds;       // request kind of each latency sample
+    int errors;
+    int completed;     // requests that got a response
+    int writes;        // add/delete requests sent so far
+    char buffer[65536];
+    size_t length;
+    size_t parsed;
+} Client;
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int connectServer(const Options *options) {
+    int fd;
+
+    if (options->unixPath != NULL) {
+        struct sockaddr_un addr;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, options->unixPath, sizeof(addr.sun_path) - 1);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        struct sockaddr_in addr;
+        int one = 1;
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons((unsigned short)options->port);
+        if (fd >= 0) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    return fd;
+}
+
+int sendAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return 0;
+}
+
+// Parse one complete response from the client buffer. Returns 1 when a
+// response was consumed, 0 if more data is needed.
+int parseResponse(Client *client, int *ok) {
+    char *start = client->buffer + client->parsed;
+    char *end = client->buffer + client->length;
+    char *newline = (char *)memchr(start, '\n', (size_t)(end - start));
+    if (newline == NULL) {
+        return 0;
+    }
+
+    int lines = 0;
+    *ok = strncmp(start, "OK ", 3) == 0;
+    if (*ok) {
+        lines = atoi(start + 3);
+    }
+
+    char *cursor = newline + 1;
+    while (lines > 0) {
+        newline = (char *)memchr(cursor, '\n', (size_t)(end - cursor));
+        if (newline == NULL) {
+            return 0;
+        }
+        cursor = newline + 1;
+        lines--;
+    }
+    client->parsed = (size_t)(cursor - client->buffer);
+    return 1;
+}
+
+// Block until one response has arrived
+int readResponse(Client *client, int *ok) {
+    while (!parseResponse(client, ok)) {
+        if (client->parsed > 0) {
+            memmove(client->buffer, client->buffer + client->parsed, client->length - client->parsed);
+            client->length -= client->parsed;
+            client->parsed = 0;
+        }
+        if (client->length == sizeof(client->buffer)) {
+            fprintf(stderr, "response too large\n");
+            return -1;
+        }
+        ssize_t received = recv(client->fd, client->buffer + client->length, sizeof(client->buffer) - client->length, 0);
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        client->length += (size_t)received;
+    }
+    return 0;
+}
+
+int formatRequest(Client *client, int i, char *request, size_t size, char *kind) {
+    const Options *options = client->options;
+    unsigned int r = (unsigned int)(client->id * 2654435761u + i * 40503u);
+    int percent = (int)(r % 100);
+
+    // Writes alternate between adding a song and deleting it again so the
+    // catalog size stays steady
+    if (percent < options->writePercent) {
+        int key = client->writes / 2;
+        *kind = KIND_WRITE;
+        if (client->writes++ % 2 == 0) {
+            return snprintf(request, size, "add|load %d %d|%s|%s|%d\n", client->id, key,
+                            artists[key % ARTIST_COUNT], genres[key % GENRE_COUNT], 1960 + key % 64);
+        }
+        return snprintf(request, size, "delete|load %d %d\n", client->id, key);
+    }
+    if (percent < options->writePercent + options->scanPercent) {
+        *kind = KIND_SCAN;
+        return snprintf(request, size, "artist|nobody\n");
+    }
+    *kind = KIND_FIND;
+    return snprintf(request, size, "find|song %d\n", (int)((r / 7) % (unsigned int)options->songs));
+}
+
+void *clientThread(void *arg) {
+    Client *client = (Client *)arg;
+    const Options *options = client->options;
+    double *sentAt = (double *)malloc((size_t)options->depth * sizeof(double));
+    char request[256];
+    int sent = 0;
+    int received = 0;
+
+    while (received < options->requests) {
+        // Top the pipeline up to depth requests in flight
+        while (sent < options->requests && sent - received < options->depth) {
+            int length = formatRequest(client, sent, request, sizeof(request), &client->kinds[sent]);
+            sentAt[sent % options->depth] = now();
+            if (sendAll(client->fd, request, (size_t)length) != 0) {
+                perror("send");
+                client->completed = received;
+                free(sentAt);
+                return NULL;
+            }
+            sent++;
+        }
+
+        int ok;
+        if (readResponse(client, &ok) != 0) {
+            fprintf(stderr, "connection %d closed early\n", client->id);
+            break;
+        }
+        client->latencies[received] = now() - sentAt[received % options->depth];
+        if (!ok) {
+            client->errors++;
+        }
+        received++;
+    }
+
+    client->completed = received;
+    free(sentAt);
+    return NULL;
+}
+
+int preload(const Options *options) {
+    Client client;
+    char request[256];
+    int inFlight = 0;
+    int ok;
+    int i;
+
+    memset(&client, 0, sizeof(client));
+    client.options = options;
+    client.fd = connectServer(options);
+    if (client.fd < 0) {
+        perror("connect");
+        return -1;
+    }
+
+    // Pipeline the adds, draining replies as we go so neither side's socket
+    // buffer fills up
+    for (i = 0; i < options->songs || inFlight > 0; ) {
+        if (i < options->songs && inFlight < 1024) {
+            int length = snprintf(request, sizeof(request), "add|song %d|%s|%s|%d\n", i,
+                                  artists[i % ARTIST_COUNT], genres[(i / 3) % GENRE_COUNT], 1960 + i % 64);
+            if (sendAll(client.fd, request, (size_t)length) != 0) {
+                perror("send");
+                break;
+            }
+            i++;
+            inFlight++;
+            continue;
+        }
+        if (readResponse(&client, &ok) != 0) {
+            break;
+        }
+        inFlight--;
+    }
+
+    close(client.fd);
+    return inFlight == 0 && i == options->songs ? 0 : -1;
+}
+
+int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Sort the samples and print their percentiles in microseconds
+void reportLatency(const char *label, double *samples, int count) {
+    if (count == 0) {
+        return;
+    }
+    qsort(samples, (size_t)count, sizeof(double), compareDoubles);
+    printf("%-5s latency us: p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f  (%d requests)\n", label,
+           samples[count / 2] * 1e6, samples[(int)(count * 0.99)] * 1e6,
+           samples[(int)(count * 0.999)] * 1e6, samples[count - 1] * 1e6, count);
+}
+
+int main(int argc, char *argv[]) {
+    Options options = { 7070, NULL, 4, 100000, 16, 10, 0, 100000 };
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "p:u:c:n:d:w:a:s:")) != -1) {
+        switch (opt) {
+            case 'p': options.port = atoi(optarg); break;
+            case 'u': options.unixPath = optarg; break;
+            case 'c': options.connections = atoi(optarg); break;
+            case 'n': options.requests = atoi(optarg); break;
+            case 'd': options.depth = atoi(optarg); break;
+            case 'w': options.writePercent = atoi(optarg); break;
+            case 'a': options.scanPercent = atoi(optarg); break;
+            case 's': options.songs = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-p port] [-u socket-path] [-c connections] [-n requests] "
+                                "[-d depth] [-w write-percent] [-a scan-percent] [-s preload-songs]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (options.connections < 1 || options.requests < 1 || options.depth < 1 || options.songs < 1) {
+        fprintf(stderr, "connections, requests, depth and songs must be positive\n");
+        return 1;
+    }
+
+    double start = now();
+    if (preload(&options) != 0) {
+        return 1;
+    }
+    printf("preloaded %d songs in %.3f s\n", options.songs, now() - start);
+
+    Client *clients = (Client *)calloc((size_t)options.connections, sizeof(Client));
+    pthread_t *threads = (pthread_t *)malloc((size_t)options.connections * sizeof(pthread_t));
+    size_t samples = (size_t)options.connections * (size_t)options.requests;
+    double *latencies = (double *)calloc(samples, sizeof(double));
+    double *byKind = (double *)malloc(samples * sizeof(double));
+    char *kinds = (char *)calloc(samples, 1);
+    if (clients == NULL || threads == NULL || latencies == NULL || byKind == NULL || kinds == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    for (i = 0; i < options.connections; i++) {
+        clients[i].options = &options;
+        clients[i].id = i;
+        clients[i].latencies = latencies + (size_t)i * options.requests;
+        clients[i].kinds = kinds + (size_t)i * options.requests;
+        clients[i].fd = connectServer(&options);
+        if (clients[i].fd < 0) {
+            perror("connect");
+            return 1;
+        }
+    }
+
+    start = now();
+    for (i = 0; i < options.connections; i++) {
+        pthread_create(&threads[i], NULL, clientThread, &clients[i]);
+    }
+    for (i = 0; i < options.connections; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now() - start;
+
+    // Only requests that got a response have a latency sample; pack them
+    // together so a connection that closed early does not report zeros
+    int requested = options.connections * options.requests;
+    int total = 0;
+    int errors = 0;
+    for (i = 0; i < options.connections; i++) {
+        memmove(latencies + total, clients[i].latencies, (size_t)clients[i].completed * sizeof(double));
+        memmove(kinds + total, clients[i].kinds, (size_t)clients[i].completed);
+        total += clients[i].completed;
+        errors += clients[i].errors;
+        close(clients[i].fd);
+    }
+    if (total < requested) {
+        fprintf(stderr, "only %d of %d requests completed; reporting those\n", total, requested);
+    }
+    if (total == 0) {
+        return 1;
+    }
+
+    printf("%d requests over %d connections (depth %d, %d%% writes, %d%% scans) in %.3f s\n",
+           total, options.connections, options.depth, options.writePercent, options.scanPercent, elapsed);
+    printf("throughput %.0f req/s, %d error replies\n", total / elapsed, errors);
+
+    // Split the samples by kind before the overall sort reorders them
+    int kind;
+    for (kind = 0; kind < KIND_COUNT; kind++) {
+        int count = 0;
+        for (i = 0; i < total; i++) {
+            if (kinds[i] == kind) {
+                byKind[count++] = latencies[i];
+            }
+        }
+        if (count < total) {
+            reportLatency(kindNames[kind], byKind, count);
+        }
+    }
+    reportLatency("all", latencies, total);
+
+    free(kinds);
+    free(byKind);
+    free(latencies);
+    free(threads);
+    free(clients);
+    return total < requested ? 1 : 0;
+}
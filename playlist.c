@@ -0,0 +1,588 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "playlist.h"
+#include "changefeed.h"
+
+typedef struct song {
+    char title[PLAYLIST_TITLE_MAX];
+    char artist[PLAYLIST_ARTIST_MAX];
+    char genre[PLAYLIST_GENRE_MAX];
+    int year;
+    struct song *left;
+    struct song *right;
+    int height;
+} Song;
+
+// Symbol table entry: how many songs share a given artist or genre. name
+// is always the exact spelling of at least one of those songs.
+typedef struct symbolNode {
+    char name[PLAYLIST_ARTIST_MAX];
+    int count;
+    int spelled;        // songs spelled exactly like name
+    struct symbolNode *next;
+} SymbolNode;
+
+typedef struct symbolTable {
+    SymbolNode *head;
+} SymbolTable;
+
+struct playlist {
+    Song *root;
+    int size;
+    SymbolTable artists;
+    SymbolTable genres;
+    ChangeFeed *feed;   // optional, see changefeed.h
+};
+
+static int stricmp(const char *a, const char *b) {
+    while (*a && *b) {
+        int diff = tolower((unsigned char)*a) - tolower((unsigned char)*b);
+        if (diff != 0) {
+            return diff;
+        }
+        ++a;
+        ++b;
+    }
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+}
+
+static SymbolNode *findSymbol(SymbolTable *table, const char *name) {
+    SymbolNode *node = table->head;
+    while (node != NULL && stricmp(node->name, name) != 0) {
+        node = node->next;
+    }
+    return node;
+}
+
+// Make sure the table can count name; the count itself is bumped by addSymbol
+static PlaylistStatus reserveSymbol(SymbolTable *table, const char *name) {
+    if (findSymbol(table, name) != NULL) {
+        return PLAYLIST_OK;
+    }
+
+    SymbolNode *node = (SymbolNode *)malloc(sizeof(SymbolNode));
+    if (node == NULL) {
+        return PLAYLIST_ERR_NOMEM;
+    }
+    strcpy(node->name, name);
+    node->count = 0;
+    node->spelled = 0;
+    node->next = table->head;
+    table->head = node;
+    return PLAYLIST_OK;
+}
+
+static void addSymbol(SymbolTable *table, const char *name) {
+    SymbolNode *node = findSymbol(table, name);
+    node->count++;
+    if (strcmp(node->name, name) == 0) {
+        node->spelled++;
+    }
+}
+
+// Returns the symbol if the last song spelled like its name was removed
+// while other songs still count towards it; see respellSymbol
+static SymbolNode *removeSymbol(SymbolTable *table, const char *name) {
+    SymbolNode **link = &table->head;
+    while (*link != NULL && stricmp((*link)->name, name) != 0) {
+        link = &(*link)->next;
+    }
+    if (*link == NULL) {
+        return NULL;
+    }
+
+    SymbolNode *node = *link;
+    if (--node->count == 0) {
+        *link = node->next;
+        free(node);
+        return NULL;
+    }
+    if (strcmp(node->name, name) == 0 && --node->spelled == 0) {
+        return node;
+    }
+    return NULL;
+}
+
+static void dropUnusedSymbols(SymbolTable *table) {
+    SymbolNode **link = &table->head;
+    while (*link != NULL) {
+        SymbolNode *node = *link;
+        if (node->count == 0) {
+            *link = node->next;
+            free(node);
+        } else {
+            link = &node->next;
+        }
+    }
+}
+
+static void freeSymbolTable(SymbolTable *table) {
+    SymbolNode *node = table->head;
+    while (node != NULL) {
+        SymbolNode *next = node->next;
+        free(node);
+        node = next;
+    }
+    table->head = NULL;
+}
+
+static PlaylistStatus mostCommonSymbol(const SymbolTable *table, char *name, size_t nameSize, int *count) {
+    const SymbolNode *best = NULL;
+    const SymbolNode *node;
+
+    for (node = table->head; node != NULL; node = node->next) {
+        if (best == NULL || node->count > best->count) {
+            best = node;
+        }
+    }
+    if (best == NULL) {
+        return PLAYLIST_ERR_EMPTY;
+    }
+
+    size_t length = strlen(best->name);
+    if (length >= nameSize) {
+        length = nameSize - 1;
+    }
+    memcpy(name, best->name, length);
+    name[length] = '\0';
+    *count = best->count;
+    return PLAYLIST_OK;
+}
+
+static int max(int a, int b) {
+    return (a > b) ? a : b;
+}
+
+static int height(Song *node) {
+    if (node == NULL) {
+        return 0;
+    }
+    return node->height;
+}
+
+static int getBalance(Song *node) {
+    if (node == NULL) {
+        return 0;
+    }
+    return height(node->left) - height(node->right);
+}
+
+static Song *rightRotate(Song *y) {
+    Song *x = y->left;
+    Song *T2 = x->right;
+
+    x->right = y;
+    y->left = T2;
+
+    y->height = max(height(y->left), height(y->right)) + 1;
+    x->height = max(height(x->left), height(x->right)) + 1;
+
+    return x;
+}
+
+static Song *leftRotate(Song *x) {
+    Song *y = x->right;
+    Song *T2 = y->left;
+
+    y->left = x;
+    x->right = T2;
+
+    x->height = max(height(x->left), height(x->right)) + 1;
+    y->height = max(height(y->left), height(y->right)) + 1;
+
+    return y;
+}
+
+static Song *rebalance(Song *node) {
+    // Update height
+    node->height = 1 + max(height(node->left), height(node->right));
+
+    // Get the balance factor
+    int balance = getBalance(node);
+
+    // Perform rotations if needed
+    if (balance > 1 && getBalance(node->left) >= 0) {
+        return rightRotate(node);
+    }
+    if (balance < -1 && getBalance(node->right) <= 0) {
+        return leftRotate(node);
+    }
+    if (balance > 1 && getBalance(node->left) < 0) {
+        node->left = leftRotate(node->left);
+        return rightRotate(node);
+    }
+    if (balance < -1 && getBalance(node->right) > 0) {
+        node->right = rightRotate(node->right);
+        return leftRotate(node);
+    }
+
+    return node;
+}
+
+// The caller has already checked that title is not in the tree
+static Song *insert(Song *node, Song *song) {
+    if (node == NULL) {
+        return song;
+    }
+
+    if (stricmp(song->title, node->title) < 0) {
+        node->left = insert(node->left, song);
+    } else {
+        node->right = insert(node->right, song);
+    }
+
+    return rebalance(node);
+}
+
+static Song *findSongByTitle(Song *root, const char *title) {
+    while (root != NULL) {
+        int cmp = stricmp(title, root->title);
+        if (cmp == 0) {
+            return root;
+        }
+        root = cmp < 0 ? root->left : root->right;
+    }
+    return NULL;
+}
+
+static Song *findMin(Song *node) {
+    while (node->left != NULL) {
+        node = node->left;
+    }
+    return node;
+}
+
+// The caller has already checked that title is in the tree
+static Song *deleteNode(Song *node, const char *title) {
+    int cmp = stricmp(title, node->title);
+    if (cmp < 0) {
+        node->left = deleteNode(node->left, title);
+    } else if (cmp > 0) {
+        node->right = deleteNode(node->right, title);
+    } else {
+        if (node->left == NULL) {
+            Song *temp = node->right;
+            free(node);
+            return temp;
+        } else if (node->right == NULL) {
+            Song *temp = node->left;
+            free(node);
+            return temp;
+        } else {
+            Song *temp = findMin(node->right);
+            strcpy(node->title, temp->title);
+            strcpy(node->artist, temp->artist);
+            strcpy(node->genre, temp->genre);
+            node->year = temp->year;
+            node->right = deleteNode(node->right, temp->title);
+        }
+    }
+
+    return rebalance(node);
+}
+
+static void freeTree(Song *node) {
+    if (node == NULL) {
+        return;
+    }
+    freeTree(node->left);
+    freeTree(node->right);
+    free(node);
+}
+
+static void toSongInfo(const Song *song, SongInfo *info) {
+    info->title = song->title;
+    info->artist = song->artist;
+    info->genre = song->genre;
+    info->year = song->year;
+}
+
+static void visitSong(const Song *song, SongVisitor visitor, void *context) {
+    SongInfo info;
+    if (visitor != NULL) {
+        toSongInfo(song, &info);
+        visitor(&info, context);
+    }
+}
+
+static int inorder(const Song *node, SongVisitor visitor, void *context) {
+    if (node == NULL) {
+        return 0;
+    }
+    int count = inorder(node->left, visitor, context);
+    visitSong(node, visitor, context);
+    return count + 1 + inorder(node->right, visitor, context);
+}
+
+enum filterField { FILTER_ARTIST, FILTER_GENRE, FILTER_YEAR };
+
+typedef struct filter {
+    enum filterField field;
+    const char *text;
+    int year;
+} Filter;
+
+static int matches(const Song *song, const Filter *filter) {
+    switch (filter->field) {
+        case FILTER_ARTIST:
+            return stricmp(filter->text, song->artist) == 0;
+        case FILTER_GENRE:
+            return stricmp(filter->text, song->genre) == 0;
+        case FILTER_YEAR:
+            return song->year == filter->year;
+    }
+    return 0;
+}
+
+static int filterSongs(const Song *node, const Filter *filter, SongVisitor visitor, void *context) {
+    if (node == NULL) {
+        return 0;
+    }
+    int count = filterSongs(node->left, filter, visitor, context);
+    if (matches(node, filter)) {
+        visitSong(node, visitor, context);
+        count++;
+    }
+    return count + filterSongs(node->right, filter, visitor, context);
+}
+
+// 30 random bits from two steps of the classic rand_r LCG
+static int nextRandom(unsigned int *seed) {
+    unsigned int high, low;
+
+    *seed = *seed * 1103515245u + 12345u;
+    high = (*seed >> 16) & 0x7fff;
+    *seed = *seed * 1103515245u + 12345u;
+    low = (*seed >> 16) & 0x7fff;
+    return (int)(high << 15 | low);
+}
+
+static void shufflePlaylist(const Song *root, const Song *shuffled[], int *index, unsigned int *seed) {
+    if (root == NULL) {
+        return;
+    }
+
+    shufflePlaylist(root->left, shuffled, index, seed);
+
+    // Randomly select an index to insert the current song
+    int randomIndex = nextRandom(seed) % (*index + 1);
+    if (randomIndex < *index) {
+        shuffled[*index] = shuffled[randomIndex]; // Move the existing song to the end
+    }
+    shuffled[randomIndex] = root; // Insert the current song at the random index
+    (*index)++;
+
+    shufflePlaylist(root->right, shuffled, index, seed);
+}
+
+static int validField(const char *text, size_t size) {
+    return text != NULL && text[0] != '\0' && strlen(text) < size;
+}
+
+Playlist *playlistCreate(void) {
+    return (Playlist *)calloc(1, sizeof(Playlist));
+}
+
+void playlistDestroy(Playlist *playlist) {
+    if (playlist == NULL) {
+        return;
+    }
+    freeTree(playlist->root);
+    freeSymbolTable(&playlist->artists);
+    freeSymbolTable(&playlist->genres);
+    free(playlist);
+}
+
+PlaylistStatus playlistAdd(Playlist *playlist, const char *title, const char *artist, const char *genre, int year) {
+    if (!validField(title, PLAYLIST_TITLE_MAX) || !validField(artist, PLAYLIST_ARTIST_MAX) ||
+        !validField(genre, PLAYLIST_GENRE_MAX) || year <= 0) {
+        return PLAYLIST_ERR_INVALID;
+    }
+    if (findSongByTitle(playlist->root, title) != NULL) {
+        return PLAYLIST_ERR_EXISTS;
+    }
+
+    // Allocate everything up front so a failure leaves the playlist untouched
+    Song *song = (Song *)malloc(sizeof(Song));
+    if (song == NULL) {
+        return PLAYLIST_ERR_NOMEM;
+    }
+    if (reserveSymbol(&playlist->artists, artist) != PLAYLIST_OK ||
+        reserveSymbol(&playlist->genres, genre) != PLAYLIST_OK) {
+        dropUnusedSymbols(&playlist->artists);
+        dropUnusedSymbols(&playlist->genres);
+        free(song);
+        return PLAYLIST_ERR_NOMEM;
+    }
+
+    strcpy(song->title, title);
+    strcpy(song->artist, artist);
+    strcpy(song->genre, genre);
+    song->year = year;
+    song->left = song->right = NULL;
+    song->height = 1;
+
+    playlist->root = insert(playlist->root, song);
+    playlist->size++;
+    addSymbol(&playlist->artists, artist);
+    addSymbol(&playlist->genres, genre);
+
+    if (playlist->feed != NULL) {
+        SongInfo info;
+        toSongInfo(song, &info);
+        changeFeedPublish(playlist->feed, CHANGE_ADD, &info);
+    }
+    return PLAYLIST_OK;
+}
+
+// Take the spelling of the first remaining song that counts towards symbol.
+// field is the offset of the artist or genre in Song. This walks the whole
+// tree, but only runs when the last song with the old spelling goes.
+static void respellSymbol(const Song *node, SymbolNode *symbol, size_t field) {
+    if (node == NULL) {
+        return;
+    }
+    const char *name = (const char *)node + field;
+    if (stricmp(name, symbol->name) == 0) {
+        if (symbol->spelled == 0) {
+            strcpy(symbol->name, name);
+        }
+        if (strcmp(name, symbol->name) == 0) {
+            symbol->spelled++;
+        }
+    }
+    respellSymbol(node->left, symbol, field);
+    respellSymbol(node->right, symbol, field);
+}
+
+PlaylistStatus playlistDelete(Playlist *playlist, const char *title) {
+    if (title == NULL) {
+        return PLAYLIST_ERR_INVALID;
+    }
+
+    Song *song = findSongByTitle(playlist->root, title);
+    if (song == NULL) {
+        return PLAYLIST_ERR_NOT_FOUND;
+    }
+
+    // deleteNode frees the node or overwrites it with its successor, so keep
+    // a copy of the song for the key and the change feed
+    Song removed = *song;
+    SongInfo info;
+    toSongInfo(&removed, &info);
+
+    SymbolNode *artist = removeSymbol(&playlist->artists, removed.artist);
+    SymbolNode *genre = removeSymbol(&playlist->genres, removed.genre);
+    playlist->root = deleteNode(playlist->root, removed.title);
+    playlist->size--;
+    if (artist != NULL) {
+        respellSymbol(playlist->root, artist, offsetof(Song, artist));
+    }
+    if (genre != NULL) {
+        respellSymbol(playlist->root, genre, offsetof(Song, genre));
+    }
+
+    if (playlist->feed != NULL) {
+        changeFeedPublish(playlist->feed, CHANGE_DELETE, &info);
+    }
+    return PLAYLIST_OK;
+}
+
+PlaylistStatus playlistFind(const Playlist *playlist, const char *title, SongInfo *song) {
+    if (title == NULL) {
+        return PLAYLIST_ERR_INVALID;
+    }
+
+    Song *found = findSongByTitle(playlist->root, title);
+    if (found == NULL) {
+        return PLAYLIST_ERR_NOT_FOUND;
+    }
+    if (song != NULL) {
+        toSongInfo(found, song);
+    }
+    return PLAYLIST_OK;
+}
+
+void playlistAttachChangeFeed(Playlist *playlist, ChangeFeed *feed) {
+    playlist->feed = feed;
+}
+
+int playlistSize(const Playlist *playlist) {
+    return playlist->size;
+}
+
+int playlistForEach(const Playlist *playlist, SongVisitor visitor, void *context) {
+    return inorder(playlist->root, visitor, context);
+}
+
+int playlistFilterByArtist(const Playlist *playlist, const char *artist, SongVisitor visitor, void *context) {
+    Filter filter = { FILTER_ARTIST, artist, 0 };
+    if (artist == NULL) {
+        return 0;
+    }
+    return filterSongs(playlist->root, &filter, visitor, context);
+}
+
+int playlistFilterByGenre(const Playlist *playlist, const char *genre, SongVisitor visitor, void *context) {
+    Filter filter = { FILTER_GENRE, genre, 0 };
+    if (genre == NULL) {
+        return 0;
+    }
+    return filterSongs(playlist->root, &filter, visitor, context);
+}
+
+int playlistFilterByYear(const Playlist *playlist, int year, SongVisitor visitor, void *context) {
+    Filter filter = { FILTER_YEAR, NULL, year };
+    return filterSongs(playlist->root, &filter, visitor, context);
+}
+
+PlaylistStatus playlistShuffle(const Playlist *playlist, unsigned int *seed, SongVisitor visitor, void *context) {
+    if (playlist->size == 0) {
+        return PLAYLIST_ERR_EMPTY;
+    }
+
+    const Song **shuffled = (const Song **)malloc(playlist->size * sizeof(Song *));
+    if (shuffled == NULL) {
+        return PLAYLIST_ERR_NOMEM;
+    }
+
+    int index = 0;
+    int i;
+    shufflePlaylist(playlist->root, shuffled, &index, seed);
+    for (i = 0; i < index; i++) {
+        visitSong(shuffled[i], visitor, context);
+    }
+    free(shuffled);
+    return PLAYLIST_OK;
+}
+
+PlaylistStatus playlistMostCommonArtist(const Playlist *playlist, char *artist, int *count) {
+    return mostCommonSymbol(&playlist->artists, artist, PLAYLIST_ARTIST_MAX, count);
+}
+
+PlaylistStatus playlistMostCommonGenre(const Playlist *playlist, char *genre, int *count) {
+    return mostCommonSymbol(&playlist->genres, genre, PLAYLIST_GENRE_MAX, count);
+}
+
+const char *playlistStatusString(PlaylistStatus status) {
+    switch (status) {
+        case PLAYLIST_OK:
+            return "ok";
+        case PLAYLIST_ERR_NOMEM:
+            return "out of memory";
+        case PLAYLIST_ERR_INVALID:
+            return "invalid argument";
+        case PLAYLIST_ERR_EXISTS:
+            return "song already exists";
+        case PLAYLIST_ERR_NOT_FOUND:
+            return "song not found";
+        case PLAYLIST_ERR_EMPTY:
+            return "playlist is empty";
+        case PLAYLIST_ERR_LAPPED:
+            return "change feed lapped";
+    }
+    return "unknown error";
+}
@@ -0,0 +1,72 @@
+#ifndef PLAYLIST_H
+#define PLAYLIST_H
+
+// Music playlist engine.
+//
+// Songs are kept in an AVL tree ordered by title (case-insensitive). Artist
+// and genre counts are kept in symbol tables next to the tree so the
+// statistics don't need a full scan. Nothing in the library prints; every
+// operation reports its outcome through a PlaylistStatus or a return value.
+//
+// A Playlist has no internal locking. The read-only calls (the ones taking a
+// const Playlist *) touch no shared state, so any number of threads may run
+// them at once as long as no add or delete runs concurrently. playlistAdd,
+// playlistDelete, playlistDestroy and playlistAttachChangeFeed need exclusive
+// access.
+
+#define PLAYLIST_TITLE_MAX 100   // sizes include the terminating '\0'
+#define PLAYLIST_ARTIST_MAX 100
+#define PLAYLIST_GENRE_MAX 50
+
+typedef struct playlist Playlist;
+
+typedef enum playlistStatus {
+    PLAYLIST_OK = 0,
+    PLAYLIST_ERR_NOMEM,       // allocation failed, playlist unchanged
+    PLAYLIST_ERR_INVALID,     // empty or too long field, or year <= 0
+    PLAYLIST_ERR_EXISTS,      // a song with the same title is already present
+    PLAYLIST_ERR_NOT_FOUND,   // no song with that title
+    PLAYLIST_ERR_EMPTY,       // operation needs at least one song
+    PLAYLIST_ERR_LAPPED       // change feed records were overwritten before being read
+} PlaylistStatus;
+
+// Read-only view of a song. The strings point into the playlist and stay
+// valid until the next add or delete.
+typedef struct songInfo {
+    const char *title;
+    const char *artist;
+    const char *genre;
+    int year;
+} SongInfo;
+
+// Called once per song by the traversal and filter functions.
+typedef void (*SongVisitor)(const SongInfo *song, void *context);
+
+Playlist *playlistCreate(void);
+void playlistDestroy(Playlist *playlist);   // frees every song and symbol table entry
+
+PlaylistStatus playlistAdd(Playlist *playlist, const char *title, const char *artist, const char *genre, int year);
+PlaylistStatus playlistDelete(Playlist *playlist, const char *title);
+PlaylistStatus playlistFind(const Playlist *playlist, const char *title, SongInfo *song);
+int playlistSize(const Playlist *playlist);
+
+// Visit songs in title order. The filters return the number of matching
+// songs; visitor may be NULL to only count them.
+int playlistForEach(const Playlist *playlist, SongVisitor visitor, void *context);
+int playlistFilterByArtist(const Playlist *playlist, const char *artist, SongVisitor visitor, void *context);
+int playlistFilterByGenre(const Playlist *playlist, const char *genre, SongVisitor visitor, void *context);
+int playlistFilterByYear(const Playlist *playlist, int year, SongVisitor visitor, void *context);
+
+// Visit every song once in random order. seed is the caller's random state
+// and is advanced by the call; give each thread its own.
+PlaylistStatus playlistShuffle(const Playlist *playlist, unsigned int *seed, SongVisitor visitor, void *context);
+
+// Artists and genres are counted case-insensitively; the name returned is
+// spelled as one of the songs in the playlist has it. artist must hold
+// PLAYLIST_ARTIST_MAX bytes, genre PLAYLIST_GENRE_MAX bytes.
+PlaylistStatus playlistMostCommonArtist(const Playlist *playlist, char *artist, int *count);
+PlaylistStatus playlistMostCommonGenre(const Playlist *playlist, char *genre, int *count);
+
+const char *playlistStatusString(PlaylistStatus status);
+
+#endif
@@ -0,0 +1,951 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "playlist.h"
+#include "changefeed.h"
+
+// Playlist query server.
+//
+//   playlist_server [-p port] [-u socket-path] [-r reader-threads]
+//                   [-f change-feed-capacity]
+//
+// Line protocol, one request per line (fields separated by '|'):
+//
+//   add|title|artist|genre|year      delete|title
+//   find|title                       artist|name
+//   genre|name                       year|year
+//   shuffle                          stats
+//   size                             snapshot
+//   changes|from-sequence
+//
+// Every request gets one response, in request order:
+//
+//   OK <n>          followed by n data lines
+//   ERR <message>
+//
+// Songs are returned as title|artist|genre|year.
+//
+// To follow the playlist, send snapshot. It replies OK <n> <cursor> with
+// every song, and cursor is the sequence of the first change the snapshot
+// does not include. Then poll changes from that cursor. That replies
+// OK <n> <oldest> <next> followed by up to MAX_CHANGES lines of the form
+// sequence|add|title|artist|genre|year or sequence|delete|..., where oldest
+// and next bound the records the feed still holds. Ask again from the last
+// sequence + 1 for more. A client that fell out of the feed gets
+// ERR change feed lapped <oldest> <next> and must take a new snapshot.
+//
+// Clients may pipeline any number of requests. One epoll thread does all
+// socket I/O. It hands runs of consecutive reads from a connection to a
+// pool of reader threads, and runs of writes to a single writer thread that
+// applies every queued batch under one write lock. A connection has at most
+// one batch in flight, so each client still sees its own writes in order.
+//
+// Readers take the playlist lock once per request, and the lock prefers
+// writers, so a queued write waits for at most one read request to finish.
+// changes does not take the lock at all; it reads the lock-free feed.
+// A read batch also stops after READ_BUDGET_NS; its unfinished requests go
+// back to the connection and are queued again behind other connections.
+
+#define DEFAULT_PORT 7070
+#define DEFAULT_READERS 2
+#define DEFAULT_FEED_CAPACITY 65536
+#define MAX_CHANGES 1024           // change records per reply
+#define MAX_LINE 1024
+#define MAX_BATCH 256              // requests per job
+#define READ_BUDGET_NS 2000000     // time a read job may run before yielding
+#define MAX_PENDING_INPUT (1 << 20)
+#define MAX_PENDING_OUTPUT (1 << 20)
+#define READ_CHUNK 16384
+#define MAX_EVENTS 64
+
+typedef struct buffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+    int failed;        // an append was dropped for lack of memory
+} Buffer;
+
+typedef struct connection {
+    int fd;
+    Buffer in;         // request bytes not yet handed to a worker
+    Buffer out;        // response bytes not yet written
+    size_t outSent;
+    int busy;          // a job for this connection is queued or running
+    int eof;           // peer finished sending
+    int failed;        // drop the connection once the job in flight returns
+    int closed;        // freed at the end of the current event loop round
+    int watched;       // registered with epoll
+    uint32_t events;   // events registered with epoll
+    struct connection *next;
+} Connection;
+
+typedef struct job {
+    Connection *conn;
+    int write;
+    char *requests;    // copy of the request lines
+    size_t length;
+    size_t consumed;   // bytes of requests that have been answered
+    Buffer output;
+    struct job *next;
+} Job;
+
+typedef struct jobQueue {
+    Job *head;
+    Job *tail;
+    int stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} JobQueue;
+
+typedef struct server {
+    Playlist *playlist;
+    ChangeFeed *feed;
+    pthread_rwlock_t playlistLock;
+    JobQueue reads;
+    JobQueue writes;
+    JobQueue done;     // finished jobs, drained by the I/O thread
+    int doneEvent;     // eventfd signalled when done gets a job
+    int epollFd;
+    Connection *closed;
+} Server;
+
+static int bufferReserve(Buffer *buffer, size_t extra) {
+    if (buffer->length + extra <= buffer->capacity) {
+        return 0;
+    }
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 256;
+    while (capacity < buffer->length + extra) {
+        capacity *= 2;
+    }
+    char *data = (char *)realloc(buffer->data, capacity);
+    if (data == NULL) {
+        buffer->failed = 1;
+        return -1;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+static int bufferAppend(Buffer *buffer, const char *data, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    if (bufferReserve(buffer, length) != 0) {
+        return -1;
+    }
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    return 0;
+}
+
+static int bufferPrintf(Buffer *buffer, const char *format, ...) {
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0) {
+        buffer->failed = 1;
+        return -1;
+    }
+    if (bufferReserve(buffer, (size_t)length + 1) != 0) {
+        return -1;
+    }
+
+    va_start(args, format);
+    vsnprintf(buffer->data + buffer->length, (size_t)length + 1, format, args);
+    va_end(args);
+    buffer->length += (size_t)length;
+    return 0;
+}
+
+static int bufferPrepend(Buffer *buffer, const char *data, size_t length) {
+    if (bufferReserve(buffer, length) != 0) {
+        return -1;
+    }
+    memmove(buffer->data + length, buffer->data, buffer->length);
+    memcpy(buffer->data, data, length);
+    buffer->length += length;
+    return 0;
+}
+
+static void bufferConsume(Buffer *buffer, size_t length) {
+    memmove(buffer->data, buffer->data + length, buffer->length - length);
+    buffer->length -= length;
+}
+
+static void bufferFree(Buffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = buffer->capacity = 0;
+    buffer->failed = 0;
+}
+
+static void queueInit(JobQueue *queue) {
+    queue->head = queue->tail = NULL;
+    queue->stopping = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->ready, NULL);
+}
+
+static void queueDestroy(JobQueue *queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->ready);
+}
+
+static void queuePush(JobQueue *queue, Job *job) {
+    job->next = NULL;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail == NULL) {
+        queue->head = job;
+    } else {
+        queue->tail->next = job;
+    }
+    queue->tail = job;
+    pthread_cond_signal(&queue->ready);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Take one job (or all queued jobs when all is set). Blocks until there is
+// work; returns NULL once the queue is stopping.
+static Job *queuePop(JobQueue *queue, int all) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->head == NULL && !queue->stopping) {
+        pthread_cond_wait(&queue->ready, &queue->lock);
+    }
+
+    Job *jobs = queue->head;
+    if (jobs != NULL) {
+        if (all) {
+            queue->head = queue->tail = NULL;
+        } else {
+            queue->head = jobs->next;
+            if (queue->head == NULL) {
+                queue->tail = NULL;
+            }
+            jobs->next = NULL;
+        }
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return jobs;
+}
+
+// Non-blocking variant used by the I/O thread
+static Job *queueTakeAll(JobQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    Job *jobs = queue->head;
+    queue->head = queue->tail = NULL;
+    pthread_mutex_unlock(&queue->lock);
+    return jobs;
+}
+
+static void queueStop(JobQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->stopping = 1;
+    pthread_cond_broadcast(&queue->ready);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void freeJob(Job *job) {
+    free(job->requests);
+    bufferFree(&job->output);
+    free(job);
+}
+
+static int isWriteRequest(const char *line) {
+    return strncmp(line, "add|", 4) == 0 || strncmp(line, "delete|", 7) == 0;
+}
+
+static void replyStatus(Buffer *out, PlaylistStatus status) {
+    if (status == PLAYLIST_OK) {
+        bufferPrintf(out, "OK 0\n");
+    } else {
+        bufferPrintf(out, "ERR %s\n", playlistStatusString(status));
+    }
+}
+
+typedef struct songList {
+    Buffer lines;
+    int count;
+} SongList;
+
+static void collectSong(const SongInfo *song, void *context) {
+    SongList *list = (SongList *)context;
+    if (!list->lines.failed &&
+        bufferPrintf(&list->lines, "%s|%s|%s|%d\n", song->title, song->artist, song->genre, song->year) == 0) {
+        list->count++;
+    }
+}
+
+// A partial list is never sent: the count would not match what the client
+// asked for
+static void replySongs(Buffer *out, SongList *list) {
+    if (list->lines.failed) {
+        replyStatus(out, PLAYLIST_ERR_NOMEM);
+        return;
+    }
+    bufferPrintf(out, "OK %d\n", list->count);
+    bufferAppend(out, list->lines.data, list->lines.length);
+}
+
+static void replyChanges(Buffer *out, const ChangeFeed *feed, uint64_t cursor) {
+    uint64_t next = changeFeedNextSequence(feed);
+    int max = MAX_CHANGES;
+    if (cursor >= next) {
+        max = 0;
+    } else if (next - cursor < MAX_CHANGES) {
+        max = (int)(next - cursor);
+    }
+    ChangeRecord *records = (ChangeRecord *)malloc((size_t)(max ? max : 1) * sizeof(ChangeRecord));
+    int count = 0;
+    int i;
+
+    if (records == NULL) {
+        replyStatus(out, PLAYLIST_ERR_NOMEM);
+        return;
+    }
+    PlaylistStatus status = changeFeedRead(feed, &cursor, records, max, &count);
+    if (status != PLAYLIST_OK) {
+        free(records);
+        bufferPrintf(out, "ERR %s %llu %llu\n", playlistStatusString(status),
+                     (unsigned long long)changeFeedOldestSequence(feed),
+                     (unsigned long long)changeFeedNextSequence(feed));
+        return;
+    }
+
+    bufferPrintf(out, "OK %d %llu %llu\n", count,
+                 (unsigned long long)changeFeedOldestSequence(feed), (unsigned long long)next);
+    for (i = 0; i < count; i++) {
+        const ChangeRecord *record = &records[i];
+        bufferPrintf(out, "%llu|%s|%s|%s|%s|%d\n", (unsigned long long)record->sequence,
+                     record->type == CHANGE_ADD ? "add" : "delete",
+                     record->title, record->artist, record->genre, record->year);
+    }
+    free(records);
+}
+
+// changes only reads the feed, which is safe without the playlist lock
+static int needsLock(const char *line) {
+    return strncmp(line, "changes|", 8) != 0;
+}
+
+// Run one request line against the playlist; the caller holds the lock
+// unless needsLock() says otherwise
+static void execute(Server *server, char *line, Buffer *out, unsigned int *seed) {
+    Playlist *playlist = server->playlist;
+    char *fields[5] = { NULL };
+    int n = 0;
+    char *start = line;
+
+    while (n < 5) {
+        char *sep = strchr(start, '|');
+        fields[n++] = start;
+        if (sep == NULL) {
+            break;
+        }
+        *sep = '\0';
+        start = sep + 1;
+    }
+
+    const char *cmd = fields[0];
+    SongList list = { { NULL, 0, 0, 0 }, 0 };
+
+    if (strcmp(cmd, "add") == 0 && n == 5) {
+        replyStatus(out, playlistAdd(playlist, fields[1], fields[2], fields[3], atoi(fields[4])));
+    } else if (strcmp(cmd, "delete") == 0 && n == 2) {
+        replyStatus(out, playlistDelete(playlist, fields[1]));
+    } else if (strcmp(cmd, "find") == 0 && n == 2) {
+        SongInfo song;
+        PlaylistStatus status = playlistFind(playlist, fields[1], &song);
+        if (status == PLAYLIST_OK) {
+            collectSong(&song, &list);
+            replySongs(out, &list);
+        } else {
+            replyStatus(out, status);
+        }
+    } else if (strcmp(cmd, "artist") == 0 && n == 2) {
+        playlistFilterByArtist(playlist, fields[1], collectSong, &list);
+        replySongs(out, &list);
+    } else if (strcmp(cmd, "genre") == 0 && n == 2) {
+        playlistFilterByGenre(playlist, fields[1], collectSong, &list);
+        replySongs(out, &list);
+    } else if (strcmp(cmd, "year") == 0 && n == 2) {
+        playlistFilterByYear(playlist, atoi(fields[1]), collectSong, &list);
+        replySongs(out, &list);
+    } else if (strcmp(cmd, "shuffle") == 0 && n == 1) {
+        PlaylistStatus status = playlistShuffle(playlist, seed, collectSong, &list);
+        if (status == PLAYLIST_OK) {
+            replySongs(out, &list);
+        } else {
+            replyStatus(out, status);
+        }
+    } else if (strcmp(cmd, "stats") == 0 && n == 1) {
+        char artist[PLAYLIST_ARTIST_MAX], genre[PLAYLIST_GENRE_MAX];
+        int artistCount = 0, genreCount = 0;
+        PlaylistStatus status = playlistMostCommonArtist(playlist, artist, &artistCount);
+        if (status == PLAYLIST_OK) {
+            status = playlistMostCommonGenre(playlist, genre, &genreCount);
+        }
+        if (status == PLAYLIST_OK) {
+            bufferPrintf(out, "OK 2\nartist|%s|%d\ngenre|%s|%d\n", artist, artistCount, genre, genreCount);
+        } else {
+            replyStatus(out, status);
+        }
+    } else if (strcmp(cmd, "size") == 0 && n == 1) {
+        bufferPrintf(out, "OK 1\n%d\n", playlistSize(playlist));
+    } else if (strcmp(cmd, "snapshot") == 0 && n == 1) {
+        // Writers publish under the write lock, so the cursor matches the
+        // songs read under this read lock
+        uint64_t cursor = changeFeedNextSequence(server->feed);
+        playlistForEach(playlist, collectSong, &list);
+        if (list.lines.failed) {
+            replyStatus(out, PLAYLIST_ERR_NOMEM);
+        } else {
+            bufferPrintf(out, "OK %d %llu\n", list.count, (unsigned long long)cursor);
+            bufferAppend(out, list.lines.data, list.lines.length);
+        }
+    } else if (strcmp(cmd, "changes") == 0 && n == 2) {
+        replyChanges(out, server->feed, strtoull(fields[1], NULL, 10));
+    } else {
+        bufferPrintf(out, "ERR unknown command\n");
+    }
+
+    bufferFree(&list.lines);
+}
+
+static long long nowNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Write jobs run whole under the writer's lock. Read jobs lock around each
+// request and stop once READ_BUDGET_NS has passed, leaving job->consumed
+// short of job->length.
+static void runJob(Server *server, Job *job, unsigned int *seed) {
+    char *line = job->requests;
+    char *end = job->requests + job->length;
+    long long deadline = nowNanos() + READ_BUDGET_NS;
+
+    while (line < end) {
+        char *newline = (char *)memchr(line, '\n', (size_t)(end - line));
+        *newline = '\0';
+        if (newline > line && newline[-1] == '\r') {
+            newline[-1] = '\0';
+        }
+        if (line[0] != '\0') {
+            int lock = !job->write && needsLock(line);
+            if (lock) {
+                pthread_rwlock_rdlock(&server->playlistLock);
+            }
+            execute(server, line, &job->output, seed);
+            if (lock) {
+                pthread_rwlock_unlock(&server->playlistLock);
+            }
+        }
+        line = newline + 1;
+        if (!job->write && nowNanos() >= deadline) {
+            break;
+        }
+    }
+    job->consumed = (size_t)(line - job->requests);
+}
+
+static void finishJobs(Server *server, Job *jobs) {
+    uint64_t one = 1;
+
+    while (jobs != NULL) {
+        Job *next = jobs->next;
+        queuePush(&server->done, jobs);
+        jobs = next;
+    }
+    if (write(server->doneEvent, &one, sizeof(one)) < 0) {
+        perror("eventfd write");
+    }
+}
+
+static void *readerThread(void *arg) {
+    Server *server = (Server *)arg;
+    // Each thread gets its own shuffle state
+    unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)(uintptr_t)&seed;
+    Job *job;
+
+    while ((job = queuePop(&server->reads, 0)) != NULL) {
+        runJob(server, job, &seed);
+        finishJobs(server, job);
+    }
+    return NULL;
+}
+
+// Applies every write batch queued since the last round under a single lock
+static void *writerThread(void *arg) {
+    Server *server = (Server *)arg;
+    unsigned int seed = (unsigned int)time(NULL);
+    Job *jobs;
+
+    while ((jobs = queuePop(&server->writes, 1)) != NULL) {
+        Job *job;
+        pthread_rwlock_wrlock(&server->playlistLock);
+        for (job = jobs; job != NULL; job = job->next) {
+            runJob(server, job, &seed);
+        }
+        pthread_rwlock_unlock(&server->playlistLock);
+        finishJobs(server, jobs);
+    }
+    return NULL;
+}
+
+// Read while there is room for more input, write while output is pending.
+// A failed connection that still has a job in flight is taken out of epoll
+// entirely; otherwise a hangup would keep waking the loop until it returns.
+static void updateEvents(Server *server, Connection *conn) {
+    struct epoll_event event;
+
+    if (conn->failed) {
+        if (conn->watched) {
+            epoll_ctl(server->epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+            conn->watched = 0;
+        }
+        return;
+    }
+
+    event.events = 0;
+    if (!conn->eof && conn->in.length < MAX_PENDING_INPUT) {
+        event.events |= EPOLLIN;
+    }
+    if (conn->outSent < conn->out.length) {
+        event.events |= EPOLLOUT;
+    }
+    if (event.events != conn->events) {
+        event.data.ptr = conn;
+        epoll_ctl(server->epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+        conn->events = event.events;
+    }
+}
+
+// Other events from the same epoll_wait round may still point at conn, so
+// it is only freed by freeClosed
+static void closeConnection(Server *server, Connection *conn) {
+    close(conn->fd);
+    conn->closed = 1;
+    conn->next = server->closed;
+    server->closed = conn;
+}
+
+static void freeClosed(Server *server) {
+    while (server->closed != NULL) {
+        Connection *conn = server->closed;
+        server->closed = conn->next;
+        bufferFree(&conn->in);
+        bufferFree(&conn->out);
+        free(conn);
+    }
+}
+
+// Hand the next run of same-kind complete requests to a worker
+static void dispatch(Server *server, Connection *conn) {
+    if (conn->busy || conn->failed || conn->out.length - conn->outSent > MAX_PENDING_OUTPUT) {
+        return;
+    }
+
+    size_t length = 0;
+    int count = 0;
+    int isWrite = -1;
+    while (count < MAX_BATCH) {
+        char *line = conn->in.data + length;
+        char *newline = (char *)memchr(line, '\n', conn->in.length - length);
+        if (newline == NULL) {
+            break;
+        }
+        if (isWrite < 0) {
+            isWrite = isWriteRequest(line);
+        } else if (isWriteRequest(line) != isWrite) {
+            break;
+        }
+        length = (size_t)(newline - conn->in.data) + 1;
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    Job *job = (Job *)calloc(1, sizeof(Job));
+    if (job == NULL || (job->requests = (char *)malloc(length)) == NULL) {
+        free(job);
+        conn->failed = 1;
+        return;
+    }
+    memcpy(job->requests, conn->in.data, length);
+    job->length = length;
+    job->conn = conn;
+    job->write = isWrite;
+    bufferConsume(&conn->in, length);
+
+    conn->busy = 1;
+    queuePush(isWrite ? &server->writes : &server->reads, job);
+}
+
+static void flush(Connection *conn) {
+    while (conn->outSent < conn->out.length) {
+        ssize_t sent = send(conn->fd, conn->out.data + conn->outSent, conn->out.length - conn->outSent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            conn->failed = 1;
+            return;
+        }
+        conn->outSent += (size_t)sent;
+    }
+
+    if (conn->outSent == conn->out.length) {
+        conn->out.length = conn->outSent = 0;
+    } else if (conn->outSent > conn->out.capacity / 2) {
+        bufferConsume(&conn->out, conn->outSent);
+        conn->outSent = 0;
+    }
+}
+
+// Move the connection forward after any event: dispatch the next batch,
+// write what is ready and close once there is nothing left to do. dispatch
+// holds back while too much output is pending, so keep alternating while
+// flush makes room; otherwise requests already in conn->in would wait for
+// the client to send more.
+static void settle(Server *server, Connection *conn) {
+    while (1) {
+        dispatch(server, conn);
+        if (conn->failed) {
+            break;
+        }
+        size_t pending = conn->out.length - conn->outSent;
+        flush(conn);
+        if (conn->busy || conn->failed || conn->out.length - conn->outSent == pending) {
+            break;
+        }
+    }
+
+    int waiting = conn->in.length > 0 && memchr(conn->in.data, '\n', conn->in.length) != NULL;
+    if (!conn->busy && (conn->failed || (conn->eof && !waiting && conn->out.length == 0))) {
+        closeConnection(server, conn);
+        return;
+    }
+    // Also while busy: level-triggered epoll would otherwise keep reporting
+    // a full input buffer or drained output until the job returns
+    updateEvents(server, conn);
+}
+
+static void readConnection(Server *server, Connection *conn) {
+    while (!conn->eof && !conn->failed && conn->in.length < MAX_PENDING_INPUT) {
+        if (bufferReserve(&conn->in, READ_CHUNK) != 0) {
+            conn->failed = 1;
+            break;
+        }
+        ssize_t received = recv(conn->fd, conn->in.data + conn->in.length, READ_CHUNK, 0);
+        if (received > 0) {
+            conn->in.length += (size_t)received;
+            continue;
+        }
+        if (received == 0) {
+            conn->eof = 1;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            conn->failed = 1;
+        }
+        break;
+    }
+
+    // Reject a request line that is still growing past MAX_LINE
+    const char *lastNewline = conn->in.length ? (const char *)memrchr(conn->in.data, '\n', conn->in.length) : NULL;
+    size_t partial = lastNewline == NULL ? conn->in.length : conn->in.length - (size_t)(lastNewline - conn->in.data) - 1;
+    if (partial > MAX_LINE) {
+        conn->failed = 1;
+    }
+    settle(server, conn);
+}
+
+static void acceptConnections(Server *server, int listenFd) {
+    while (1) {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("accept");
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Connection *conn = (Connection *)calloc(1, sizeof(Connection));
+        if (conn == NULL) {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->events = EPOLLIN;
+
+        struct epoll_event event;
+        event.events = conn->events;
+        event.data.ptr = conn;
+        if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            perror("epoll_ctl");
+            closeConnection(server, conn);
+            continue;
+        }
+        conn->watched = 1;
+    }
+}
+
+static void completeJobs(Server *server) {
+    uint64_t count;
+    if (read(server->doneEvent, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        perror("eventfd read");
+    }
+
+    Job *job = queueTakeAll(&server->done);
+    while (job != NULL) {
+        Job *next = job->next;
+        Connection *conn = job->conn;
+
+        conn->busy = 0;
+        // A reply that could not be formatted leaves a gap in the response
+        // stream the client has no way to detect, so drop the connection
+        if (job->output.failed) {
+            conn->failed = 1;
+        }
+        if (!conn->failed && bufferAppend(&conn->out, job->output.data, job->output.length) != 0) {
+            conn->failed = 1;
+        }
+        // A read job that ran out of time hands its remaining requests back
+        if (!conn->failed && job->consumed < job->length &&
+            bufferPrepend(&conn->in, job->requests + job->consumed, job->length - job->consumed) != 0) {
+            conn->failed = 1;
+        }
+        freeJob(job);
+        settle(server, conn);
+        job = next;
+    }
+}
+
+static int listenTcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    struct sockaddr_in addr;
+
+    if (fd < 0) {
+        return -1;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int listenUnix(const char *path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr;
+
+    if (fd < 0) {
+        return -1;
+    }
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        close(fd);
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    int port = DEFAULT_PORT;
+    int readers = DEFAULT_READERS;
+    int feedCapacity = DEFAULT_FEED_CAPACITY;
+    const char *unixPath = NULL;
+    int opt;
+    int i;
+
+    while ((opt = getopt(argc, argv, "p:u:r:f:")) != -1) {
+        switch (opt) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'u':
+                unixPath = optarg;
+                break;
+            case 'r':
+                readers = atoi(optarg);
+                break;
+            case 'f':
+                feedCapacity = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-p port] [-u socket-path] [-r reader-threads] [-f change-feed-capacity]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (readers < 1) {
+        readers = 1;
+    }
+
+    int listenFd = unixPath != NULL ? listenUnix(unixPath) : listenTcp(port);
+    if (listenFd < 0) {
+        perror("listen");
+        return 1;
+    }
+
+    // Shut down cleanly on SIGINT/SIGTERM
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    Server server;
+    server.playlist = playlistCreate();
+    server.feed = changeFeedCreate(feedCapacity);
+    server.doneEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (server.playlist == NULL || server.feed == NULL || server.doneEvent < 0 || signalFd < 0) {
+        perror("setup");
+        return 1;
+    }
+    playlistAttachChangeFeed(server.playlist, server.feed);
+    server.closed = NULL;
+    // The default Linux rwlock prefers readers, which lets a steady stream
+    // of reads starve the writer thread
+    pthread_rwlockattr_t lockAttr;
+    pthread_rwlockattr_init(&lockAttr);
+    pthread_rwlockattr_setkind_np(&lockAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&server.playlistLock, &lockAttr);
+    pthread_rwlockattr_destroy(&lockAttr);
+    queueInit(&server.reads);
+    queueInit(&server.writes);
+    queueInit(&server.done);
+
+    server.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &listenFd;
+    epoll_ctl(server.epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.ptr = &server.doneEvent;
+    epoll_ctl(server.epollFd, EPOLL_CTL_ADD, server.doneEvent, &event);
+    event.data.ptr = &signalFd;
+    epoll_ctl(server.epollFd, EPOLL_CTL_ADD, signalFd, &event);
+
+    pthread_t *threads = (pthread_t *)malloc((size_t)(readers + 1) * sizeof(pthread_t));
+    if (threads == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    pthread_create(&threads[0], NULL, writerThread, &server);
+    for (i = 1; i <= readers; i++) {
+        pthread_create(&threads[i], NULL, readerThread, &server);
+    }
+
+    if (unixPath != NULL) {
+        printf("Listening on %s with %d reader threads\n", unixPath, readers);
+    } else {
+        printf("Listening on 127.0.0.1:%d with %d reader threads\n", port, readers);
+    }
+    fflush(stdout);
+
+    int running = 1;
+    while (running) {
+        struct epoll_event events[MAX_EVENTS];
+        int ready = epoll_wait(server.epollFd, events, MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+
+        for (i = 0; i < ready; i++) {
+            void *source = events[i].data.ptr;
+            if (source == &listenFd) {
+                acceptConnections(&server, listenFd);
+            } else if (source == &server.doneEvent) {
+                completeJobs(&server);
+            } else if (source == &signalFd) {
+                running = 0;
+            } else {
+                Connection *conn = (Connection *)source;
+                if (conn->closed) {
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    readConnection(&server, conn);
+                } else if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    conn->eof = 1;
+                    conn->failed = 1;
+                    settle(&server, conn);
+                } else {
+                    settle(&server, conn);
+                }
+            }
+        }
+        freeClosed(&server);
+    }
+
+    queueStop(&server.reads);
+    queueStop(&server.writes);
+    for (i = 0; i <= readers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    close(server.epollFd);
+    close(listenFd);
+    close(signalFd);
+    close(server.doneEvent);
+    if (unixPath != NULL) {
+        unlink(unixPath);
+    }
+    queueDestroy(&server.reads);
+    queueDestroy(&server.writes);
+    queueDestroy(&server.done);
+    pthread_rwlock_destroy(&server.playlistLock);
+    playlistDestroy(server.playlist);
+    changeFeedDestroy(server.feed);
+    return 0;
+}
@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "playlist.h"
+#include "catalog.h"
+#include "changefeed.h"
+
+// Unit tests, run by ctest. Configure with -DPLAYLIST_SANITIZE=ON to run
+// them under AddressSanitizer and UndefinedBehaviorSanitizer.
+
+int failures = 0;
+
+#define CHECK(condition)                                                  \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                   \
+        }                                                                 \
+    } while (0)
+
+void countSong(const SongInfo *song, void *context) {
+    (void)song;
+    (*(int *)context)++;
+}
+
+void testAddFindDelete() {
+    Playlist *playlist = playlistCreate();
+    SongInfo song;
+    char name[PLAYLIST_ARTIST_MAX];
+    int count = 0;
+
+    CHECK(playlist != NULL);
+    CHECK(playlistSize(playlist) == 0);
+    CHECK(playlistMostCommonArtist(playlist, name, &count) == PLAYLIST_ERR_EMPTY);
+
+    CHECK(playlistAdd(playlist, "Bohemian Rhapsody", "Queen", "Rock", 1975) == PLAYLIST_OK);
+    CHECK(playlistAdd(playlist, "Dancing Queen", "ABBA", "Pop", 1976) == PLAYLIST_OK);
+    CHECK(playlistAdd(playlist, "We Will Rock You", "queen", "rock", 1977) == PLAYLIST_OK);
+    CHECK(playlistSize(playlist) == 3);
+
+    // Titles are unique regardless of case
+    CHECK(playlistAdd(playlist, "bohemian rhapsody", "Someone", "Pop", 2000) == PLAYLIST_ERR_EXISTS);
+    CHECK(playlistSize(playlist) == 3);
+
+    CHECK(playlistAdd(playlist, "", "Queen", "Rock", 1975) == PLAYLIST_ERR_INVALID);
+    CHECK(playlistAdd(playlist, "Title", "Queen", "Rock", 0) == PLAYLIST_ERR_INVALID);
+
+    CHECK(playlistFind(playlist, "DANCING QUEEN", &song) == PLAYLIST_OK);
+    CHECK(strcmp(song.artist, "ABBA") == 0 && song.year == 1976);
+    CHECK(playlistFind(playlist, "Missing", &song) == PLAYLIST_ERR_NOT_FOUND);
+
+    count = 0;
+    CHECK(playlistFilterByArtist(playlist, "QUEEN", countSong, &count) == 2 && count == 2);
+    CHECK(playlistFilterByGenre(playlist, "rock", NULL, NULL) == 2);
+    CHECK(playlistFilterByYear(playlist, 1976, NULL, NULL) == 1);
+    CHECK(playlistForEach(playlist, NULL, NULL) == 3);
+
+    CHECK(playlistMostCommonArtist(playlist, name, &count) == PLAYLIST_OK);
+    CHECK(strcmp(name, "Queen") == 0 && count == 2);
+
+    CHECK(playlistDelete(playlist, "bohemian RHAPSODY") == PLAYLIST_OK);
+    CHECK(playlistDelete(playlist, "Bohemian Rhapsody") == PLAYLIST_ERR_NOT_FOUND);
+    CHECK(playlistSize(playlist) == 2);
+    CHECK(playlistFind(playlist, "Bohemian Rhapsody", NULL) == PLAYLIST_ERR_NOT_FOUND);
+    CHECK(playlistFilterByArtist(playlist, "queen", NULL, NULL) == 1);
+
+    // Filters must leave the tree intact
+    CHECK(playlistFind(playlist, "We Will Rock You", NULL) == PLAYLIST_OK);
+    CHECK(playlistFind(playlist, "Dancing Queen", NULL) == PLAYLIST_OK);
+
+    playlistDestroy(playlist);
+}
+
+// The most common name is always spelled as a song still in the playlist
+void testStatsSpelling() {
+    Playlist *playlist = playlistCreate();
+    char name[PLAYLIST_ARTIST_MAX];
+    int count = 0;
+
+    playlistAdd(playlist, "Song A", "Queen", "Rock", 1975);
+    playlistAdd(playlist, "Song B", "queen", "ROCK", 1976);
+    playlistAdd(playlist, "Song C", "QUEEN", "rock", 1977);
+    playlistAdd(playlist, "Song D", "queen", "Rock", 1978);
+    CHECK(playlistMostCommonArtist(playlist, name, &count) == PLAYLIST_OK);
+    CHECK(strcmp(name, "Queen") == 0 && count == 4);
+
+    // Any remaining spelling will do
+    CHECK(playlistDelete(playlist, "Song A") == PLAYLIST_OK);
+    CHECK(playlistMostCommonArtist(playlist, name, &count) == PLAYLIST_OK);
+    CHECK((strcmp(name, "queen") == 0 || strcmp(name, "QUEEN") == 0) && count == 3);
+    CHECK(playlistMostCommonGenre(playlist, name, &count) == PLAYLIST_OK);
+    CHECK(strcmp(name, "Rock") == 0 && count == 3);
+
+    CHECK(playlistDelete(playlist, "Song B") == PLAYLIST_OK);
+    CHECK(playlistMostCommonArtist(playlist, name, &count) == PLAYLIST_OK);
+    CHECK((strcmp(name, "queen") == 0 || strcmp(name, "QUEEN") == 0) && count == 2);
+
+    CHECK(playlistDelete(playlist, "Song D") == PLAYLIST_OK);
+    CHECK(playlistMostCommonArtist(playlist, name, &count) == PLAYLIST_OK);
+    CHECK(strcmp(name, "QUEEN") == 0 && count == 1);
+    CHECK(playlistMostCommonGenre(playlist, name, &count) == PLAYLIST_OK);
+    CHECK(strcmp(name, "rock") == 0 && count == 1);
+
+    playlistDestroy(playlist);
+}
+
+void recordTitle(const SongInfo *song, void *context) {
+    char *order = (char *)context;
+    strncat(order, song->title, 1);
+}
+
+// Same seed, same order; every song visited once
+void testShuffle() {
+    Playlist *playlist = playlistCreate();
+    unsigned int seed = 0;
+    char first[32] = "", second[32] = "";
+    char title[2] = "a";
+    int i;
+
+    CHECK(playlistShuffle(playlist, &seed, NULL, NULL) == PLAYLIST_ERR_EMPTY);
+    for (i = 0; i < 26; i++) {
+        title[0] = (char)('a' + i);
+        playlistAdd(playlist, title, "artist", "genre", 2000);
+    }
+
+    seed = 42;
+    CHECK(playlistShuffle(playlist, &seed, recordTitle, first) == PLAYLIST_OK);
+    seed = 42;
+    CHECK(playlistShuffle(playlist, &seed, recordTitle, second) == PLAYLIST_OK);
+    CHECK(strlen(first) == 26 && strcmp(first, second) == 0);
+    CHECK(strcmp(first, "abcdefghijklmnopqrstuvwxyz") != 0);
+    for (i = 0; i < 26; i++) {
+        CHECK(strchr(first, 'a' + i) != NULL);
+    }
+
+    playlistDestroy(playlist);
+}
+
+// Enough songs to exercise every rotation, then destroy with songs left
+void testManySongs() {
+    Playlist *playlist = playlistCreate();
+    char title[32];
+    int i;
+
+    for (i = 0; i < 2000; i++) {
+        snprintf(title, sizeof(title), "song %d", (i * 7919) % 2000);
+        CHECK(playlistAdd(playlist, title, i % 2 ? "a" : "b", "g", 1900 + i % 100) == PLAYLIST_OK);
+    }
+    for (i = 0; i < 2000; i += 3) {
+        snprintf(title, sizeof(title), "song %d", i);
+        CHECK(playlistDelete(playlist, title) == PLAYLIST_OK);
+    }
+    CHECK(playlistSize(playlist) == 2000 - 667);
+    CHECK(playlistForEach(playlist, NULL, NULL) == 2000 - 667);
+    for (i = 0; i < 2000; i++) {
+        snprintf(title, sizeof(title), "song %d", i);
+        CHECK((playlistFind(playlist, title, NULL) == PLAYLIST_OK) == (i % 3 != 0));
+    }
+
+    playlistDestroy(playlist);
+}
+
+// Build a catalog over years spread across span, which picks the 8, 16 or
+// 32-bit year column, and check every kernel against a brute-force count
+void checkCatalogKernels(int firstYear, int span) {
+    static const char *artists[] = { "Queen", "abba", "QUEEN", "Nirvana", "Adele" };
+    static const char *genres[] = { "Rock", "pop", "rock", "Jazz" };
+    Playlist *playlist = playlistCreate();
+    char title[32];
+    SongInfo song;
+    int songs = 500;
+    int i, row;
+
+    for (i = 0; i < songs; i++) {
+        snprintf(title, sizeof(title), "song %d", i);
+        playlistAdd(playlist, title, artists[i % 5], genres[i % 4], firstYear + (int)((i * 7919LL) % (span + 1)));
+    }
+    playlistAdd(playlist, "last", "Adele", "Jazz", firstYear + span);
+
+    Catalog *catalog = catalogBuild(playlist);
+    CHECK(catalog != NULL);
+    if (catalog == NULL) {
+        playlistDestroy(playlist);
+        return;
+    }
+    int size = catalogSize(catalog);
+    int years = span + 1;
+    CHECK(size == songs + 1);
+    CHECK(catalogMinYear(catalog) == firstYear && catalogMaxYear(catalog) == firstYear + span);
+    CHECK(catalogArtistCount(catalog) == 4 && catalogGenreCount(catalog) == 3);
+
+    // Row accessors agree with the playlist
+    for (row = 0; row < size; row++) {
+        CHECK(playlistFind(playlist, catalogTitle(catalog, row), &song) == PLAYLIST_OK);
+        CHECK(song.year == catalogYear(catalog, row));
+        CHECK(catalogArtist(catalog, row) == catalogFindArtist(catalog, song.artist));
+        CHECK(catalogGenre(catalog, row) == catalogFindGenre(catalog, song.genre));
+    }
+
+    // Year ranges, including ones that hang off either end
+    int *rows = (int *)malloc((size_t)size * sizeof(int));
+    int ranges[][2] = { { firstYear, firstYear + span }, { firstYear - 10, firstYear + span / 3 },
+                        { firstYear + span / 2, firstYear + span + 10 }, { firstYear + 1, firstYear + 1 },
+                        { firstYear + span + 1, firstYear + span + 5 }, { firstYear + 5, firstYear } };
+    for (i = 0; i < (int)(sizeof(ranges) / sizeof(ranges[0])); i++) {
+        int from = ranges[i][0], to = ranges[i][1];
+        int expected = 0;
+        for (row = 0; row < size; row++) {
+            expected += catalogYear(catalog, row) >= from && catalogYear(catalog, row) <= to;
+        }
+        CHECK(catalogCountYears(catalog, from, to) == expected);
+        CHECK(catalogSelectYears(catalog, from, to, rows) == expected);
+        for (row = 0; row < expected; row++) {
+            CHECK(catalogYear(catalog, rows[row]) >= from && catalogYear(catalog, rows[row]) <= to);
+            CHECK(row == 0 || rows[row] > rows[row - 1]);
+        }
+    }
+
+    // Histograms, checked against the playlist's own filters
+    int artistCounts[4], genreCounts[3];
+    catalogCountArtists(catalog, artistCounts);
+    catalogCountGenres(catalog, genreCounts);
+    for (i = 0; i < 4; i++) {
+        CHECK(artistCounts[i] == playlistFilterByArtist(playlist, catalogArtistName(catalog, i), NULL, NULL));
+    }
+    for (i = 0; i < 3; i++) {
+        CHECK(genreCounts[i] == playlistFilterByGenre(playlist, catalogGenreName(catalog, i), NULL, NULL));
+    }
+
+    int *genreByYear = (int *)malloc((size_t)3 * (size_t)years * sizeof(int));
+    int *expected = (int *)calloc((size_t)3 * (size_t)years, sizeof(int));
+    catalogCountGenreByYear(catalog, genreByYear);
+    for (row = 0; row < size; row++) {
+        expected[catalogGenre(catalog, row) * years + catalogYear(catalog, row) - firstYear]++;
+    }
+    CHECK(memcmp(genreByYear, expected, (size_t)3 * (size_t)years * sizeof(int)) == 0);
+
+    free(expected);
+    free(genreByYear);
+    free(rows);
+    catalogDestroy(catalog);
+    playlistDestroy(playlist);
+}
+
+void testCatalog() {
+    checkCatalogKernels(1950, 200);       // 8-bit years
+    checkCatalogKernels(1, 40000);        // 16-bit years
+    checkCatalogKernels(1, 100000);       // 32-bit years
+}
+
+void testChangeFeed() {
+    Playlist *playlist = playlistCreate();
+    ChangeFeed *feed = changeFeedCreate(3);   // rounded up to 4
+    ChangeRecord records[8];
+    uint64_t cursor = 1;
+    char title[32];
+    int count = -1;
+    int i;
+
+    CHECK(feed != NULL);
+    playlistAttachChangeFeed(playlist, feed);
+    CHECK(changeFeedRead(feed, &cursor, records, 8, &count) == PLAYLIST_OK && count == 0 && cursor == 1);
+
+    playlistAdd(playlist, "Bohemian Rhapsody", "Queen", "Rock", 1975);
+    playlistAdd(playlist, "Dancing Queen", "ABBA", "Pop", 1976);
+    CHECK(playlistAdd(playlist, "dancing queen", "ABBA", "Pop", 1976) == PLAYLIST_ERR_EXISTS);
+    playlistDelete(playlist, "BOHEMIAN RHAPSODY");
+    CHECK(changeFeedNextSequence(feed) == 4 && changeFeedOldestSequence(feed) == 1);
+
+    // Deletes describe the song that was removed
+    CHECK(changeFeedRead(feed, &cursor, records, 8, &count) == PLAYLIST_OK && count == 3 && cursor == 4);
+    CHECK(records[0].sequence == 1 && records[0].type == CHANGE_ADD && strcmp(records[0].title, "Bohemian Rhapsody") == 0);
+    CHECK(records[1].sequence == 2 && strcmp(records[1].artist, "ABBA") == 0 && strcmp(records[1].genre, "Pop") == 0);
+    CHECK(records[2].sequence == 3 && records[2].type == CHANGE_DELETE && records[2].year == 1975);
+    CHECK(strcmp(records[2].title, "Bohemian Rhapsody") == 0 && strcmp(records[2].artist, "Queen") == 0);
+
+    // Reads stop at max and resume from the cursor
+    cursor = 1;
+    CHECK(changeFeedRead(feed, &cursor, records, 2, &count) == PLAYLIST_OK && count == 2 && cursor == 3);
+    CHECK(changeFeedRead(feed, &cursor, records, 2, &count) == PLAYLIST_OK && count == 1 && records[0].sequence == 3);
+
+    // Fall more than four records behind
+    for (i = 0; i < 6; i++) {
+        snprintf(title, sizeof(title), "song %d", i);
+        playlistAdd(playlist, title, "artist", "genre", 2000 + i);
+    }
+    cursor = 4;
+    CHECK(changeFeedRead(feed, &cursor, records, 8, &count) == PLAYLIST_ERR_LAPPED && count == 0 && cursor == 4);
+    CHECK(changeFeedOldestSequence(feed) == 6);
+    cursor = changeFeedOldestSequence(feed);
+    CHECK(changeFeedRead(feed, &cursor, records, 8, &count) == PLAYLIST_OK && count == 4 && cursor == 10);
+    CHECK(strcmp(records[3].title, "song 5") == 0 && records[3].year == 2005);
+
+    playlistAttachChangeFeed(playlist, NULL);
+    playlistDestroy(playlist);
+    changeFeedDestroy(feed);
+}
+
+// Long records run out of text space before they run out of slots
+void testChangeFeedText() {
+    Playlist *playlist = playlistCreate();
+    ChangeFeed *feed = changeFeedCreate(64);
+    ChangeRecord records[64];
+    char title[PLAYLIST_TITLE_MAX], artist[PLAYLIST_ARTIST_MAX], genre[PLAYLIST_GENRE_MAX];
+    uint64_t cursor;
+    int count = 0;
+    int i;
+
+    playlistAttachChangeFeed(playlist, feed);
+    memset(artist, 'a', sizeof(artist) - 1);
+    artist[sizeof(artist) - 1] = '\0';
+    memset(genre, 'g', sizeof(genre) - 1);
+    genre[sizeof(genre) - 1] = '\0';
+    for (i = 0; i < 60; i++) {
+        memset(title, 't', sizeof(title) - 1);
+        title[sizeof(title) - 1] = '\0';
+        title[0] = (char)('0' + i / 10);
+        title[1] = (char)('0' + i % 10);
+        CHECK(playlistAdd(playlist, title, artist, genre, 1900 + i) == PLAYLIST_OK);
+    }
+
+    uint64_t oldest = changeFeedOldestSequence(feed);
+    CHECK(oldest > 1 && changeFeedNextSequence(feed) == 61);
+    cursor = oldest - 1;
+    CHECK(changeFeedRead(feed, &cursor, records, 64, &count) == PLAYLIST_ERR_LAPPED && cursor == oldest - 1);
+    cursor = oldest;
+    CHECK(changeFeedRead(feed, &cursor, records, 64, &count) == PLAYLIST_OK && cursor == 61);
+    CHECK(count == (int)(61 - oldest));
+    for (i = 0; i < count; i++) {
+        CHECK(strlen(records[i].title) == PLAYLIST_TITLE_MAX - 1);
+        CHECK(atoi(records[i].title) == (int)records[i].sequence - 1);
+        CHECK(strcmp(records[i].artist, artist) == 0 && strcmp(records[i].genre, genre) == 0);
+        CHECK(records[i].year == 1900 + (int)records[i].sequence - 1);
+    }
+
+    playlistAttachChangeFeed(playlist, NULL);
+    playlistDestroy(playlist);
+    changeFeedDestroy(feed);
+}
+
+int main() {
+    testAddFindDelete();
+    testManySongs();
+    testStatsSpelling();
+    testShuffle();
+    testCatalog();
+    testChangeFeed();
+    testChangeFeedText();
+
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
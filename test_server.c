@@ -0,0 +1,393 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Smoke test for playlist_server, run by ctest:
+//
+//   playlist_server_test path/to/playlist_server
+//
+// Starts the server and pipelines a mixed burst of requests whose shuffle
+// replies are larger than the server's output limit, with and without a
+// half-close, checking that every request gets exactly one reply in order.
+// The burst runs over a Unix socket and over TCP; loopback TCP buffers are
+// large enough for the server to drain its whole backlog in one write.
+// Also follows the change feed through snapshot, changes and a lapped
+// resync.
+
+#define PRELOAD_SONGS 30000        // enough for a shuffle reply over 1 MB
+#define BURST_GROUPS 600
+#define FEED_CAPACITY 64
+#define READ_TIMEOUT 10            // seconds before a missing reply fails
+
+int failures = 0;
+
+#define CHECK(condition)                                                  \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                   \
+        }                                                                 \
+    } while (0)
+
+typedef struct reader {
+    int fd;
+    char buffer[65536];
+    size_t length;
+    size_t parsed;
+} Reader;
+
+// An expected reply: its header line and, if set, a prefix of its first
+// data line
+typedef struct reply {
+    char header[48];
+    char first[48];
+} Reply;
+
+typedef struct sender {
+    int fd;
+    const char *data;
+    size_t length;
+    int halfClose;
+} Sender;
+
+// Read one line without its newline. Returns 0, -1 at end of stream or -2
+// when no data arrived within READ_TIMEOUT.
+int readLine(Reader *reader, char *line, size_t size) {
+    while (1) {
+        char *start = reader->buffer + reader->parsed;
+        char *newline = (char *)memchr(start, '\n', reader->length - reader->parsed);
+        if (newline != NULL) {
+            size_t length = (size_t)(newline - start);
+            if (length >= size) {
+                length = size - 1;
+            }
+            memcpy(line, start, length);
+            line[length] = '\0';
+            reader->parsed = (size_t)(newline - reader->buffer) + 1;
+            return 0;
+        }
+
+        memmove(reader->buffer, start, reader->length - reader->parsed);
+        reader->length -= reader->parsed;
+        reader->parsed = 0;
+        if (reader->length == sizeof(reader->buffer)) {
+            return -1;
+        }
+        ssize_t received = recv(reader->fd, reader->buffer + reader->length, sizeof(reader->buffer) - reader->length, 0);
+        if (received > 0) {
+            reader->length += (size_t)received;
+        } else if (received < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) ? -2 : -1;
+        }
+    }
+}
+
+int sendAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return 0;
+}
+
+// Sending runs on its own thread so the replies can be read while the
+// burst is still going out
+void *sendThread(void *arg) {
+    Sender *sender = (Sender *)arg;
+    if (sendAll(sender->fd, sender->data, sender->length) != 0) {
+        perror("send");
+    }
+    if (sender->halfClose) {
+        shutdown(sender->fd, SHUT_WR);
+    }
+    return NULL;
+}
+
+pid_t startServer(const char *path, char *const args[]) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        execv(path, args);
+        perror("execv");
+        _exit(127);
+    }
+    return pid;
+}
+
+int stopServer(pid_t pid) {
+    int status = 0;
+    kill(pid, SIGTERM);
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Connect to a Unix socket path or, if path is NULL, to a loopback TCP
+// port, retrying while the server starts up
+int connectServer(const char *path, int port) {
+    int attempt;
+
+    for (attempt = 0; attempt < 500; attempt++) {
+        int fd;
+        int connected;
+        if (path != NULL) {
+            struct sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            connected = fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        } else {
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons((unsigned short)port);
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            connected = fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        }
+        if (connected) {
+            struct timeval timeout = { READ_TIMEOUT, 0 };
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            return fd;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        struct timespec pause = { 0, 10000000 };
+        nanosleep(&pause, NULL);
+    }
+    return -1;
+}
+
+// Append a request and the reply it should get
+void expect(char **requests, size_t *length, Reply *replies, int *count,
+            const char *request, const char *header, const char *first) {
+    *length += (size_t)sprintf(*requests + *length, "%s\n", request);
+    snprintf(replies[*count].header, sizeof(replies[*count].header), "%s", header);
+    snprintf(replies[*count].first, sizeof(replies[*count].first), "%s", first);
+    (*count)++;
+}
+
+// Send one request and read its header line
+int request(Reader *reader, const char *line, char *header, size_t size) {
+    if (sendAll(reader->fd, line, strlen(line)) != 0) {
+        return -1;
+    }
+    return readLine(reader, header, size);
+}
+
+// Pipeline the preload and a mixed burst on one connection and check the
+// replies
+void testBurst(const char *path, int port, int run, int halfClose) {
+    int total = PRELOAD_SONGS + BURST_GROUPS * 5;
+    char *requests = (char *)malloc((size_t)total * 80);
+    Reply *replies = (Reply *)malloc((size_t)total * sizeof(Reply));
+    Reader *reader = (Reader *)calloc(1, sizeof(Reader));
+    char text[80], header[48], first[48], line[256];
+    size_t length = 0;
+    int count = 0;
+    int songs = 0;
+    int i;
+
+    if (requests == NULL || replies == NULL || reader == NULL) {
+        printf("out of memory\n");
+        exit(1);
+    }
+    reader->fd = connectServer(path, port);
+    CHECK(reader->fd >= 0);
+    if (reader->fd < 0 || request(reader, "size\n", line, sizeof(line)) != 0 ||
+        readLine(reader, line, sizeof(line)) != 0) {
+        printf("could not reach the server\n");
+        exit(1);
+    }
+    songs = atoi(line);
+
+    for (i = 0; i < PRELOAD_SONGS; i++) {
+        snprintf(text, sizeof(text), "add|run %d preloaded song number %d|some artist|some genre|2000", run, i);
+        expect(&requests, &length, replies, &count, text, "OK 0", "");
+    }
+    songs += PRELOAD_SONGS;
+    for (i = 0; i < BURST_GROUPS; i++) {
+        snprintf(text, sizeof(text), "add|run %d burst %d|artist|genre|1999", run, i);
+        expect(&requests, &length, replies, &count, text, "OK 0", "");
+        snprintf(text, sizeof(text), "find|run %d burst %d", run, i);
+        snprintf(first, sizeof(first), "run %d burst %d|", run, i);
+        expect(&requests, &length, replies, &count, text, "OK 1", first);
+        if (i % 50 == 0) {
+            snprintf(header, sizeof(header), "OK %d", songs + 1);
+            expect(&requests, &length, replies, &count, "shuffle", header, "");
+        } else {
+            snprintf(first, sizeof(first), "%d", songs + 1);
+            expect(&requests, &length, replies, &count, "size", "OK 1", first);
+        }
+        snprintf(text, sizeof(text), "delete|run %d burst %d", run, i);
+        expect(&requests, &length, replies, &count, text, "OK 0", "");
+        snprintf(first, sizeof(first), "%d", songs);
+        expect(&requests, &length, replies, &count, "size", "OK 1", first);
+    }
+
+    Sender sender = { reader->fd, requests, length, halfClose };
+    pthread_t thread;
+    pthread_create(&thread, NULL, sendThread, &sender);
+
+    int received = 0;
+    int status = 0;
+    while (received < count && status == 0) {
+        const Reply *reply = &replies[received];
+        int lines = 0;
+        int j;
+        status = readLine(reader, line, sizeof(line));
+        if (status == 0 && strcmp(line, reply->header) != 0) {
+            break;
+        }
+        if (status == 0) {
+            lines = atoi(line + 3);
+        }
+        for (j = 0; j < lines && status == 0; j++) {
+            status = readLine(reader, line, sizeof(line));
+            if (status == 0 && j == 0 && strncmp(line, reply->first, strlen(reply->first)) != 0) {
+                status = 1;
+            }
+        }
+        if (status == 0) {
+            received++;
+        }
+    }
+    if (received < count) {
+        const char *problem[] = { "got", "unexpected data", "end of stream", "timed out" };
+        printf("%s run %d%s: reply %d of %d, expected %s: %s %.40s\n", path != NULL ? "unix" : "tcp", run,
+               halfClose ? " (half-closed)" : "", received + 1, count, replies[received].header,
+               problem[status < 0 ? 1 - status : status], status < 0 ? "" : line);
+    }
+    CHECK(received == count);
+    if (halfClose && received == count) {
+        // Exactly one reply per request, then the server closes
+        CHECK(readLine(reader, line, sizeof(line)) == -1);
+    }
+
+    pthread_join(thread, NULL);
+    close(reader->fd);
+    free(reader);
+    free(replies);
+    free(requests);
+}
+
+// Read a snapshot and return its cursor; the snapshot must hold songs songs
+unsigned long long takeSnapshot(Reader *reader, int songs) {
+    char line[256];
+    unsigned long long cursor = 0;
+    int count = -1;
+    int i;
+
+    CHECK(request(reader, "snapshot\n", line, sizeof(line)) == 0);
+    CHECK(sscanf(line, "OK %d %llu", &count, &cursor) == 2 && count == songs);
+    for (i = 0; i < count; i++) {
+        CHECK(readLine(reader, line, sizeof(line)) == 0);
+    }
+    return cursor;
+}
+
+// Follow the feed from a snapshot, get lapped, then resync
+void testResync(const char *path) {
+    Reader *reader = (Reader *)calloc(1, sizeof(Reader));
+    char line[256], expected[256];
+    unsigned long long oldest = 0, next = 0;
+    int count = -1;
+    int i;
+
+    reader->fd = connectServer(path, 0);
+    CHECK(reader->fd >= 0);
+    CHECK(request(reader, "add|first|a|g|2000\n", line, sizeof(line)) == 0 && strcmp(line, "OK 0") == 0);
+
+    unsigned long long cursor = takeSnapshot(reader, 1);
+    CHECK(cursor == 2);
+    CHECK(request(reader, "add|r1|a|g|2001\n", line, sizeof(line)) == 0 && strcmp(line, "OK 0") == 0);
+    CHECK(request(reader, "add|r2|b|h|2002\n", line, sizeof(line)) == 0 && strcmp(line, "OK 0") == 0);
+    CHECK(request(reader, "delete|r1\n", line, sizeof(line)) == 0 && strcmp(line, "OK 0") == 0);
+
+    snprintf(expected, sizeof(expected), "changes|%llu\n", cursor);
+    CHECK(request(reader, expected, line, sizeof(line)) == 0);
+    CHECK(sscanf(line, "OK %d %llu %llu", &count, &oldest, &next) == 3);
+    CHECK(count == 3 && oldest == 1 && next == cursor + 3);
+    const char *records[] = { "add|r1|a|g|2001", "add|r2|b|h|2002", "delete|r1|a|g|2001" };
+    for (i = 0; i < 3; i++) {
+        snprintf(expected, sizeof(expected), "%llu|%s", cursor + (unsigned long long)i, records[i]);
+        CHECK(readLine(reader, line, sizeof(line)) == 0 && strcmp(line, expected) == 0);
+    }
+    cursor += 3;
+
+    // Fall out of the feed
+    for (i = 0; i < FEED_CAPACITY * 2; i++) {
+        snprintf(expected, sizeof(expected), "add|lap %d|a|g|2000\n", i);
+        CHECK(request(reader, expected, line, sizeof(line)) == 0 && strcmp(line, "OK 0") == 0);
+    }
+    snprintf(expected, sizeof(expected), "changes|%llu\n", cursor);
+    CHECK(request(reader, expected, line, sizeof(line)) == 0);
+    CHECK(sscanf(line, "ERR change feed lapped %llu %llu", &oldest, &next) == 2);
+    CHECK(oldest > cursor && next == cursor + FEED_CAPACITY * 2);
+
+    // A new snapshot picks up where the feed is now
+    cursor = takeSnapshot(reader, 2 + FEED_CAPACITY * 2);
+    CHECK(cursor == next);
+    snprintf(expected, sizeof(expected), "changes|%llu\n", cursor);
+    CHECK(request(reader, expected, line, sizeof(line)) == 0);
+    CHECK(sscanf(line, "OK %d %llu %llu", &count, &oldest, &next) == 3 && count == 0 && next == cursor);
+
+    close(reader->fd);
+    free(reader);
+}
+
+int main(int argc, char *argv[]) {
+    char socketPath[64], portText[16], feedText[16];
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s path/to/playlist_server\n", argv[0]);
+        return 1;
+    }
+    snprintf(socketPath, sizeof(socketPath), "/tmp/playlist_server_test.%d.sock", (int)getpid());
+    snprintf(feedText, sizeof(feedText), "%d", FEED_CAPACITY);
+
+    char *unixArgs[] = { argv[1], "-u", socketPath, "-f", feedText, NULL };
+    pid_t server = startServer(argv[1], unixArgs);
+    testResync(socketPath);
+    testBurst(socketPath, 0, 0, 1);
+    testBurst(socketPath, 0, 1, 0);
+    CHECK(stopServer(server) == 0);
+
+    int port = 20000 + (int)(getpid() % 20000);
+    snprintf(portText, sizeof(portText), "%d", port);
+    char *tcpArgs[] = { argv[1], "-p", portText, NULL };
+    server = startServer(argv[1], tcpArgs);
+    testBurst(NULL, port, 0, 1);
+    testBurst(NULL, port, 1, 0);
+    CHECK(stopServer(server) == 0);
+
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}